@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct WorkloadConfig
+{
+    size_t statements = 1000;
+    size_t target_bytes = 0;
+    int max_depth = 4;
+    int terms = 4;
+    double builtin_ratio = 0.3;
+    double fin_ratio = 0.05;
+    double int_ratio = 0.3;
+    uint64_t seed = 42;
+    std::vector<std::pair<std::string, int>> builtin_mix = {
+        {"pow", 1}, {"sqrt", 1}, {"sin", 1}, {"cos", 1}, {"tan", 1},
+        {"log", 1}, {"ln", 1}, {"abs", 1}, {"rand", 1}
+    };
+};
+
+class WorkloadGenerator {
+public:
+    WorkloadGenerator(WorkloadConfig config) : config(std::move(config)), m_rng(this->config.seed) {}
+
+    std::string generate() {
+        m_output.str("");
+        m_int_vars.clear();
+        m_float_vars.clear();
+        size_t count = 0;
+        while (count < config.statements || m_output.tellp() < static_cast<std::streamoff>(config.target_bytes)) {
+            gen_stmt();
+            count++;
+        }
+        if (!m_float_vars.empty()) {
+            m_output << "fin " << m_float_vars.back() << "\n";
+        }
+        return m_output.str();
+    }
+
+    static bool set_builtin_mix(WorkloadConfig& config, const std::string& spec) {
+        std::vector<std::pair<std::string, int>> mix;
+        std::stringstream stream(spec);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            auto eq = item.find('=');
+            if (eq == std::string::npos) return false;
+            std::string name = item.substr(0, eq);
+            if (!is_builtin(name)) return false;
+            mix.push_back({name, std::stoi(item.substr(eq + 1))});
+        }
+        config.builtin_mix = mix;
+        return true;
+    }
+
+private:
+    WorkloadConfig config;
+    std::mt19937_64 m_rng;
+    std::stringstream m_output;
+    std::vector<std::string> m_int_vars;
+    std::vector<std::string> m_float_vars;
+    size_t m_next_var = 0;
+
+    static bool is_builtin(const std::string& name) {
+        for (const char* b : {"pow", "sqrt", "sin", "cos", "tan", "log", "ln", "abs", "rand"}) {
+            if (name == b) return true;
+        }
+        return false;
+    }
+
+    bool chance(double p) {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < p;
+    }
+
+    int range(int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(m_rng);
+    }
+
+    const std::string& pick(const std::vector<std::string>& items) {
+        return items[range(0, static_cast<int>(items.size()) - 1)];
+    }
+
+    std::string pick_builtin() {
+        int total = 0;
+        for (const auto& [name, weight] : config.builtin_mix) total += weight;
+        if (total <= 0) return {};
+        int roll = range(1, total);
+        for (const auto& [name, weight] : config.builtin_mix) {
+            roll -= weight;
+            if (roll <= 0) return name;
+        }
+        return {};
+    }
+
+    void gen_stmt() {
+        if (!m_float_vars.empty() && chance(config.fin_ratio)) {
+            m_output << "fin " << pick(m_float_vars) << "\n";
+            return;
+        }
+        std::string name = "v" + std::to_string(m_next_var++);
+        if (chance(config.int_ratio)) {
+            m_output << "int " << name << " = ";
+            gen_int_expr(0);
+            m_int_vars.push_back(name);
+        }
+        else {
+            m_output << "float " << name << " = ";
+            gen_float_expr(0);
+            m_float_vars.push_back(name);
+        }
+        m_output << "\n";
+    }
+
+    // Builtin calls are only accepted at the head of an expression, so any
+    // operand position gets a primary: literal, identifier or parenthesised
+    // sub-expression.
+    void gen_float_expr(int depth) {
+        std::string builtin = depth < config.max_depth && chance(config.builtin_ratio) ? pick_builtin() : "";
+        if (builtin.empty()) {
+            gen_float_primary(depth);
+        }
+        else {
+            gen_float_builtin(builtin, depth);
+        }
+        int terms = range(0, config.terms);
+        for (int i = 0; i < terms; i++) {
+            switch (range(0, 3)) {
+                case 0: m_output << " + "; gen_float_primary(depth); break;
+                case 1: m_output << " - "; gen_float_primary(depth); break;
+                case 2: m_output << " * "; gen_float_primary(depth); break;
+                default: m_output << " / " << range(1, 9) << "." << range(1, 9); break;
+            }
+        }
+    }
+
+    void gen_float_builtin(const std::string& builtin, int depth) {
+        m_output << builtin << "(";
+        if (builtin == "rand") {
+            int lo = range(0, 10);
+            m_output << lo << ", " << lo + range(1, 100);
+        }
+        else if (builtin == "pow" || builtin == "log") {
+            gen_float_expr(depth + 1);
+            m_output << ", ";
+            gen_float_expr(depth + 1);
+        }
+        else {
+            gen_float_expr(depth + 1);
+        }
+        m_output << ")";
+    }
+
+    void gen_float_primary(int depth) {
+        int roll = range(0, 9);
+        if (roll < 3 || (m_float_vars.empty() && m_int_vars.empty())) {
+            m_output << range(0, 99) << "." << range(0, 99);
+        }
+        else if (roll < 7) {
+            m_output << (m_int_vars.empty() || (!m_float_vars.empty() && chance(0.7)) ? pick(m_float_vars) : pick(m_int_vars));
+        }
+        else if (depth < config.max_depth) {
+            m_output << "(";
+            gen_float_expr(depth + 1);
+            m_output << ")";
+        }
+        else {
+            m_output << range(1, 99);
+        }
+    }
+
+    // Integer statements stay integral end to end so that the generated C++
+    // `%` is always applied to integer operands, and every divisor is a
+    // non-zero literal so evaluation never traps.
+    void gen_int_expr(int depth) {
+        int builtin_roll = depth < config.max_depth && chance(config.builtin_ratio) ? range(0, 1) : -1;
+        if (builtin_roll == 0) {
+            int lo = range(0, 10);
+            m_output << "rand(" << lo << ", " << lo + range(1, 100) << ")";
+        }
+        else if (builtin_roll == 1) {
+            m_output << "abs(";
+            gen_int_expr(depth + 1);
+            m_output << ")";
+        }
+        else {
+            gen_int_primary(depth);
+        }
+        int terms = range(0, config.terms);
+        for (int i = 0; i < terms; i++) {
+            switch (range(0, 4)) {
+                case 0: m_output << " + "; gen_int_primary(depth); break;
+                case 1: m_output << " - "; gen_int_primary(depth); break;
+                case 2: m_output << " * "; gen_int_primary(depth); break;
+                case 3: m_output << " / " << range(1, 9); break;
+                default: m_output << " mod " << range(2, 97); break;
+            }
+        }
+    }
+
+    void gen_int_primary(int depth) {
+        int roll = range(0, 9);
+        if (roll < 4 || m_int_vars.empty()) {
+            m_output << range(0, 999);
+        }
+        else if (roll < 8 || depth >= config.max_depth) {
+            m_output << pick(m_int_vars);
+        }
+        else {
+            m_output << "(";
+            gen_int_expr(depth + 1);
+            m_output << ")";
+        }
+    }
+};
@@ -0,0 +1,440 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Tokenizer.hpp"
+#include "Parser.hpp"
+#include "Generator.hpp"
+#include "Precompiled.hpp"
+#include "Evaluator.hpp"
+
+#ifndef LI_VERSION
+#define LI_VERSION "unknown"
+#endif
+
+struct StageResult
+{
+    std::string stage;
+    size_t iterations = 0;
+    double seconds = 0;
+    size_t bytes = 0;
+    size_t nodes = 0;
+    bool evals = false;
+};
+
+struct FileResult
+{
+    std::string path;
+    size_t source_bytes = 0;
+    size_t tokens = 0;
+    size_t statements = 0;
+    size_t nodes = 0;
+    size_t output_bytes = 0;
+    std::vector<StageResult> stages;
+};
+
+struct BenchOptions
+{
+    double min_time = 0.5;
+    size_t min_iterations = 3;
+    bool compile = false;
+    size_t eval_iterations = 20;
+    std::string cxx = "g++";
+    std::string cxx_flags;
+    std::string driver;
+    std::string json_path;
+};
+
+struct NodeCounter
+{
+    size_t count = 0;
+
+    // Chains are walked down their left spine with a loop, as the generator
+    // does, so the visitors below only count right operands.
+    void expr(const NodeExpr& node_expr) {
+        for (const NodeExpr* node = &node_expr; node; node = chain_left(*node)) {
+            count++;
+            std::visit(*this, node->node);
+        }
+    }
+
+    void operator()(const NodeIntLit&) {}
+    void operator()(const NodeExprIdentifier&) {}
+    void operator()(const NodeBinaryExprPlus& node) { expr(*node.right); }
+    void operator()(const NodeBinaryExprMinus& node) { expr(*node.right); }
+    void operator()(const NodeBinaryExprTimes& node) { expr(*node.right); }
+    void operator()(const NodeBinaryExprDivision& node) { expr(*node.right); }
+    void operator()(const NodeBinaryExprMod& node) { expr(*node.right); }
+    void operator()(const NodeGroupedExpr& node) { expr(*node.innerExpr); }
+    void operator()(const NodeExprPow& node) { expr(*node.base); expr(*node.exponent); }
+    void operator()(const NodeExprLog& node) { expr(*node.base); expr(*node.exponent); }
+    void operator()(const NodeExprRand& node) { expr(*node.base); expr(*node.exponent); }
+    void operator()(const NodeExprSqrt& node) { expr(*node.base); }
+    void operator()(const NodeExprSin& node) { expr(*node.base); }
+    void operator()(const NodeExprCos& node) { expr(*node.base); }
+    void operator()(const NodeExprTan& node) { expr(*node.base); }
+    void operator()(const NodeExprLn& node) { expr(*node.base); }
+    void operator()(const NodeExprAbs& node) { expr(*node.base); }
+    void operator()(const NodeExprLinspace& node) { expr(*node.start); expr(*node.stop); expr(*node.count); }
+    void operator()(const NodeExprRange& node) { expr(*node.start); expr(*node.stop); }
+    void operator()(const NodeExprArray& node) {
+        for (const auto& element : node.elements) expr(*element);
+    }
+    void operator()(const NodeExprSum& node) { expr(*node.base); }
+    void operator()(const NodeExprMax& node) { expr(*node.base); }
+    void operator()(const NodeExprMin& node) { expr(*node.base); }
+    void operator()(const NodeExprDot& node) { expr(*node.left); expr(*node.right); }
+
+    void operator()(const NodeStmtExit& node) { expr(node.expr); }
+    void operator()(const NodeStmtVarINT& node) { expr(node.expr); }
+    void operator()(const NodeStmtVarFLOAT& node) { expr(node.expr); }
+    void operator()(const NodeStmtVarARRAY& node) { expr(node.expr); }
+    void operator()(const NodeStmtPow& node) { expr(node.base); expr(node.exponent); }
+
+    size_t operator()(const Node& node) {
+        for (const auto& stmt : node.node) {
+            count++;
+            std::visit(*this, stmt.node);
+        }
+        return count;
+    }
+};
+
+// Keeps results observable so the optimizer cannot drop the measured work.
+template <typename T>
+static void keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Fn>
+static StageResult run_stage(const std::string& name, const BenchOptions& options, Fn&& fn) {
+    using clock = std::chrono::steady_clock;
+    StageResult result{name};
+    auto start = clock::now();
+    double elapsed = 0;
+    while (result.iterations < options.min_iterations || elapsed < options.min_time) {
+        fn();
+        result.iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    result.seconds = elapsed;
+    return result;
+}
+
+template <typename Fn>
+static StageResult run_fixed(const std::string& name, size_t iterations, Fn&& fn) {
+    using clock = std::chrono::steady_clock;
+    StageResult result{name};
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        if (!fn()) {
+            result.iterations = 0;
+            return result;
+        }
+        result.iterations++;
+    }
+    result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return result;
+}
+
+static std::string json_escape(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+
+static std::optional<FileResult> bench_file(const std::string& path, const BenchOptions& options) {
+    std::string source;
+    {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Error: Could not open " << path << std::endl;
+            return {};
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+    }
+
+    FileResult file_result;
+    file_result.path = path;
+    file_result.source_bytes = source.size();
+
+    Tokenizer tokenizer(source);
+    std::vector<Token> tokens = tokenizer.tokenize();
+    Parser parser(tokens);
+    std::optional<Node> parsed = parser.parse();
+    if (!parsed.has_value() || !tokenizer.diagnostics().empty() || !parser.diagnostics().empty()) {
+        for (const Diagnostic& diagnostic : tokenizer.diagnostics()) print_diagnostic(std::cerr, path, diagnostic);
+        for (const Diagnostic& diagnostic : parser.diagnostics()) print_diagnostic(std::cerr, path, diagnostic);
+        std::cerr << "Error: Failed to parse " << path << std::endl;
+        return {};
+    }
+    Node node = std::move(parsed.value());
+    std::string generated = Generator(node).generate();
+    file_result.tokens = tokens.size();
+    file_result.statements = node.node.size();
+    file_result.nodes = NodeCounter{}(node);
+    file_result.output_bytes = generated.size();
+
+    StageResult tokenize = run_stage("tokenize", options, [&] {
+        auto result = Tokenizer(source).tokenize();
+        keep(result);
+    });
+    tokenize.bytes = source.size();
+    file_result.stages.push_back(tokenize);
+
+    StageResult parse = run_stage("parse", options, [&] {
+        auto result = Parser(tokens).parse();
+        keep(result);
+    });
+    parse.bytes = source.size();
+    parse.nodes = file_result.nodes;
+    file_result.stages.push_back(parse);
+
+    StageResult generate = run_stage("generate", options, [&] {
+        auto result = Generator(node).generate();
+        keep(result);
+    });
+    generate.bytes = generated.size();
+    generate.nodes = file_result.nodes;
+    file_result.stages.push_back(generate);
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    StageResult emit = run_stage("emit", options, [&] {
+        Generator(node, null_fd).emit();
+    });
+    emit.bytes = generated.size();
+    emit.nodes = file_result.nodes;
+    file_result.stages.push_back(emit);
+
+    std::string image = PrecompiledWriter(node).write();
+    StageResult precompile = run_stage("precompile", options, [&] {
+        auto result = PrecompiledWriter(node).write();
+        keep(result);
+    });
+    precompile.bytes = image.size();
+    precompile.nodes = file_result.nodes;
+    file_result.stages.push_back(precompile);
+
+    StageResult load = run_stage("load", options, [&] {
+        PrecompiledAst ast(image.data(), image.size());
+        keep(ast);
+    });
+    load.bytes = image.size();
+    load.nodes = file_result.nodes;
+    file_result.stages.push_back(load);
+
+    PrecompiledAst ast(image.data(), image.size());
+    StageResult emit_precompiled = run_stage("emit-lic", options, [&] {
+        Generator(ast, null_fd).emit();
+    });
+    close(null_fd);
+    emit_precompiled.bytes = generated.size();
+    emit_precompiled.nodes = file_result.nodes;
+    file_result.stages.push_back(emit_precompiled);
+
+    // Runs the program in process: the alternative to compile + evaluate.
+    std::ostringstream printed;
+    bool interpreted = true;
+    StageResult interpret = run_stage("interpret", options, [&] {
+        printed.str("");
+        Evaluator evaluator(ast);
+        interpreted &= evaluator.run(printed);
+    });
+    if (!interpreted) {
+        std::cerr << "Error: Failed to evaluate " << path << " in process" << std::endl;
+        return {};
+    }
+    interpret.nodes = file_result.nodes;
+    interpret.evals = true;
+    file_result.stages.push_back(interpret);
+
+    if (!options.driver.empty()) {
+        auto dir = std::filesystem::temp_directory_path() / ("li_driver_" + std::to_string(getpid()));
+        std::filesystem::create_directories(dir);
+        std::string driver_cmd = "cd " + dir.string() + " && " + std::filesystem::absolute(options.driver).string()
+                                 + " " + std::filesystem::absolute(path).string() + " --emit-only";
+        bool failed = false;
+        StageResult driver = run_stage("driver", options, [&] {
+            failed |= system(driver_cmd.c_str()) != 0;
+        });
+        driver.bytes = source.size();
+        driver.nodes = file_result.nodes;
+        std::filesystem::remove_all(dir);
+        if (failed) {
+            std::cerr << "Error: Driver " << options.driver << " failed on " << path << std::endl;
+            return {};
+        }
+        file_result.stages.push_back(driver);
+    }
+
+    if (options.compile) {
+        auto dir = std::filesystem::temp_directory_path() / ("li_bench_" + std::to_string(getpid()));
+        std::filesystem::create_directories(dir);
+        auto cpp_path = (dir / "output.cpp").string();
+        auto bin_path = (dir / "out").string();
+        {
+            std::ofstream file(cpp_path);
+            file << generated;
+        }
+
+        std::string compile_cmd = options.cxx + " " + options.cxx_flags + " " + cpp_path + " -o " + bin_path;
+        StageResult compile = run_fixed("compile", 1, [&] {
+            return system(compile_cmd.c_str()) == 0;
+        });
+        compile.bytes = generated.size();
+        file_result.stages.push_back(compile);
+
+        if (compile.iterations > 0) {
+            std::string eval_cmd = bin_path + " > /dev/null";
+            StageResult evaluate = run_fixed("evaluate", options.eval_iterations, [&] {
+                return system(eval_cmd.c_str()) == 0;
+            });
+            evaluate.nodes = file_result.nodes;
+            evaluate.evals = true;
+            file_result.stages.push_back(evaluate);
+        }
+        else {
+            std::cerr << "Error: Failed to compile generated code for " << path << std::endl;
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    return file_result;
+}
+
+static void print_results(const std::vector<FileResult>& results) {
+    for (const auto& file : results) {
+        std::cout << file.path << " (" << file.source_bytes << " bytes, " << file.statements
+                  << " statements, " << file.nodes << " nodes)" << std::endl;
+        for (const auto& stage : file.stages) {
+            double per_iter = stage.iterations ? stage.seconds / stage.iterations : 0;
+            std::cout << "  " << std::left << std::setw(10) << stage.stage << std::right
+                      << std::setw(8) << stage.iterations << " iters  "
+                      << std::fixed << std::setprecision(3) << std::setw(12) << per_iter * 1e3 << " ms/iter";
+            if (per_iter > 0) {
+                if (stage.bytes) std::cout << std::setw(12) << stage.bytes / per_iter / 1e6 << " MB/s";
+                if (stage.nodes && !stage.evals) std::cout << std::setw(14) << std::setprecision(0) << stage.nodes / per_iter << " nodes/s";
+                if (stage.evals) std::cout << std::setw(12) << std::setprecision(2) << 1.0 / per_iter << " evals/s";
+            }
+            std::cout << std::defaultfloat << std::endl;
+        }
+    }
+}
+
+static void write_json(const std::string& path, const std::vector<FileResult>& results, const BenchOptions& options) {
+    std::ofstream out(path);
+    out << std::setprecision(10);
+    out << "{\n";
+    out << "  \"version\": \"" << json_escape(LI_VERSION) << "\",\n";
+    out << "  \"timestamp\": " << std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() << ",\n";
+    out << "  \"min_time\": " << options.min_time << ",\n";
+    out << "  \"files\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& file = results[i];
+        out << "    {\n";
+        out << "      \"path\": \"" << json_escape(file.path) << "\",\n";
+        out << "      \"source_bytes\": " << file.source_bytes << ",\n";
+        out << "      \"tokens\": " << file.tokens << ",\n";
+        out << "      \"statements\": " << file.statements << ",\n";
+        out << "      \"nodes\": " << file.nodes << ",\n";
+        out << "      \"output_bytes\": " << file.output_bytes << ",\n";
+        out << "      \"stages\": [\n";
+        for (size_t j = 0; j < file.stages.size(); j++) {
+            const auto& stage = file.stages[j];
+            double per_iter = stage.iterations ? stage.seconds / stage.iterations : 0;
+            out << "        {\"stage\": \"" << stage.stage << "\", \"iterations\": " << stage.iterations
+                << ", \"seconds\": " << stage.seconds << ", \"ns_per_iter\": " << per_iter * 1e9;
+            if (per_iter > 0) {
+                if (stage.bytes) out << ", \"mb_per_s\": " << stage.bytes / per_iter / 1e6;
+                if (stage.nodes && !stage.evals) out << ", \"nodes_per_s\": " << stage.nodes / per_iter;
+                if (stage.evals) out << ", \"evals_per_s\": " << 1.0 / per_iter;
+            }
+            out << "}" << (j + 1 < file.stages.size() ? "," : "") << "\n";
+        }
+        out << "      ]\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void usage() {
+    std::cout << "Usage: ./bench [options] <file.li>...\n"
+              << "  --json <file>          write machine-readable results\n"
+              << "  --min-time <seconds>   minimum measuring time per stage (default: 0.5)\n"
+              << "  --compile              also time g++ on the generated code and running the binary\n"
+              << "  --eval-iterations <n>  number of binary runs for the evaluate stage (default: 20)\n"
+              << "  --cxx <compiler>       compiler used for the compile stage (default: g++)\n"
+              << "  --cxx-flags <flags>    flags passed to the compile stage\n"
+              << "  --driver <binary>      also time the compiler binary end to end with --emit-only" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        }
+        else if (arg == "--compile") {
+            options.compile = true;
+        }
+        else if (arg.rfind("--", 0) == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: Missing value for " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+            std::string value = argv[++i];
+            if (arg == "--json") options.json_path = value;
+            else if (arg == "--min-time") options.min_time = std::stod(value);
+            else if (arg == "--eval-iterations") options.eval_iterations = std::stoull(value);
+            else if (arg == "--cxx") options.cxx = value;
+            else if (arg == "--cxx-flags") options.cxx_flags = value;
+            else if (arg == "--driver") options.driver = value;
+            else {
+                std::cerr << "Error: Unknown option " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<FileResult> results;
+    for (const auto& path : files) {
+        if (auto result = bench_file(path, options)) {
+            results.push_back(result.value());
+        }
+        else {
+            return EXIT_FAILURE;
+        }
+    }
+
+    print_results(results);
+    if (!options.json_path.empty()) {
+        write_json(options.json_path, results, options);
+    }
+    return 0;
+}
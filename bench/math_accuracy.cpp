@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "MathKernels.hpp"
+#include "NumericBackends.hpp"
+
+#ifndef LI_VERSION
+#define LI_VERSION "unknown"
+#endif
+
+using Scalar = double (*)(double, double);
+using Batch = void (*)(const double*, double*, size_t);
+
+struct Domain
+{
+    std::string name;
+    std::function<double(std::mt19937_64&)> x;
+    std::function<double(std::mt19937_64&)> y;
+};
+
+struct Tier
+{
+    std::string name;
+    Scalar scalar;
+    Batch batch;
+};
+
+struct MathCase
+{
+    std::string name;
+    long double (*reference)(long double, long double);
+    std::vector<Tier> tiers;
+    std::vector<Domain> domains;
+};
+
+struct CaseResult
+{
+    std::string function;
+    std::string tier;
+    std::string domain;
+    double max_ulp = 0;
+    double max_rel = 0;
+    double scalar_mevals = 0;
+    double batch_mevals = 0;
+};
+
+// One numeric backend running one builtin, measured in the backend's own
+// type. The error is |got - ref| / max(1, |ref|), since fixed point has
+// absolute rather than relative precision.
+struct BackendResult
+{
+    std::string function;
+    std::string backend;
+    std::string domain;
+    double max_err = 0;
+    double mevals = 0;
+};
+
+struct BackendCase
+{
+    std::string name;
+    long double (*reference)(long double, long double);
+    Domain domain;
+};
+
+// The precise tier's documented bound, see MathKernels.hpp; the worst case
+// measured is about 3.4 ulp, for tan.
+constexpr double precise_max_ulp = 4;
+
+static double ulp(double x) {
+    x = std::fabs(x);
+    return std::nextafter(x, INFINITY) - x;
+}
+
+static std::function<double(std::mt19937_64&)> uniform(double lo, double hi) {
+    return [=](std::mt19937_64& rng) { return std::uniform_real_distribution<double>(lo, hi)(rng); };
+}
+
+static std::function<double(std::mt19937_64&)> log_uniform(double lo, double hi) {
+    return [=](std::mt19937_64& rng) { return std::exp(std::uniform_real_distribution<double>(std::log(lo), std::log(hi))(rng)); };
+}
+
+// Keeps results observable so the optimizer cannot drop the measured work.
+static void keep(double value) {
+    asm volatile("" : : "x"(value));
+}
+
+template <typename Fn>
+static double mevals_per_s(size_t n, double min_time, Fn&& fn) {
+    using clock = std::chrono::steady_clock;
+    size_t iterations = 0;
+    auto start = clock::now();
+    double elapsed = 0;
+    while (elapsed < min_time) {
+        fn();
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    return iterations * n / elapsed / 1e6;
+}
+
+static std::vector<MathCase> cases() {
+    auto sin_ref = [](long double x, long double) { return std::sin(x); };
+    auto cos_ref = [](long double x, long double) { return std::cos(x); };
+    auto tan_ref = [](long double x, long double) { return std::tan(x); };
+    auto ln_ref = [](long double x, long double) { return std::log(x); };
+    auto exp_ref = [](long double x, long double) { return std::exp(x); };
+    auto log_ref = [](long double base, long double x) { return std::log(x) / std::log(base); };
+    auto pow_ref = [](long double x, long double y) { return std::pow(x, y); };
+
+    std::vector<Domain> trig = {
+        {"[-10,10]", uniform(-10, 10), nullptr},
+        {"[-1e5,1e5]", uniform(-1e5, 1e5), nullptr},
+    };
+
+    return {
+        {"sin", sin_ref, {
+            {"exact", [](double x, double) { return std::sin(x); }, nullptr},
+            {"precise", [](double x, double) { return limath::sin_precise(x); }, limath::sin_precise_n},
+            {"fast", [](double x, double) { return limath::sin_fast(x); }, limath::sin_fast_n},
+        }, trig},
+        {"cos", cos_ref, {
+            {"exact", [](double x, double) { return std::cos(x); }, nullptr},
+            {"precise", [](double x, double) { return limath::cos_precise(x); }, limath::cos_precise_n},
+            {"fast", [](double x, double) { return limath::cos_fast(x); }, limath::cos_fast_n},
+        }, trig},
+        {"tan", tan_ref, {
+            {"exact", [](double x, double) { return std::tan(x); }, nullptr},
+            {"precise", [](double x, double) { return limath::tan_precise(x); }, limath::tan_precise_n},
+            {"fast", [](double x, double) { return limath::tan_fast(x); }, limath::tan_fast_n},
+        }, trig},
+        {"ln", ln_ref, {
+            {"exact", [](double x, double) { return std::log(x); }, nullptr},
+            {"precise", [](double x, double) { return limath::ln_precise(x); }, limath::ln_precise_n},
+            {"fast", [](double x, double) { return limath::ln_fast(x); }, limath::ln_fast_n},
+        }, {
+            {"[0.5,2]", uniform(0.5, 2), nullptr},
+            {"[1e-300,1e300]", log_uniform(1e-300, 1e300), nullptr},
+        }},
+        {"exp", exp_ref, {
+            {"exact", [](double x, double) { return std::exp(x); }, nullptr},
+            {"precise", [](double x, double) { return limath::exp_precise(x); }, nullptr},
+            {"fast", [](double x, double) { return limath::exp_fast(x); }, nullptr},
+        }, {
+            {"[-700,700]", uniform(-700, 700), nullptr},
+        }},
+        {"log", log_ref, {
+            {"exact", [](double base, double x) { return std::log(x) / std::log(base); }, nullptr},
+            {"precise", limath::log_precise, nullptr},
+            {"fast", limath::log_fast, nullptr},
+        }, {
+            {"base [2,10], x [1e-10,1e10]", uniform(2, 10), log_uniform(1e-10, 1e10)},
+        }},
+        {"pow", pow_ref, {
+            {"exact", [](double x, double y) { return std::pow(x, y); }, nullptr},
+            {"precise", limath::pow_precise, nullptr},
+            {"fast", limath::pow_fast, nullptr},
+        }, {
+            {"x [1e-3,1e3], y [-20,20]", log_uniform(1e-3, 1e3), uniform(-20, 20)},
+        }},
+    };
+}
+
+// Domains stay inside Q16.16's range so every backend sees the same inputs.
+static std::vector<BackendCase> backend_cases() {
+    return {
+        {"sin", [](long double x, long double) { return std::sin(x); }, {"[-3,3]", uniform(-3, 3), nullptr}},
+        {"cos", [](long double x, long double) { return std::cos(x); }, {"[-3,3]", uniform(-3, 3), nullptr}},
+        {"tan", [](long double x, long double) { return std::tan(x); }, {"[-1.2,1.2]", uniform(-1.2, 1.2), nullptr}},
+        {"sqrt", [](long double x, long double) { return std::sqrt(x); }, {"[0,1000]", uniform(0, 1000), nullptr}},
+        {"ln", [](long double x, long double) { return std::log(x); }, {"[0.01,1000]", log_uniform(0.01, 1000), nullptr}},
+        {"log", [](long double base, long double x) { return std::log(x) / std::log(base); }, {"base [2,10], x [0.01,1000]", uniform(2, 10), log_uniform(0.01, 1000)}},
+        {"pow", [](long double x, long double y) { return std::pow(x, y); }, {"x [0.1,4], y [-4,4]", log_uniform(0.1, 4), uniform(-4, 4)}},
+    };
+}
+
+template <typename T>
+static long double widen(const T& x) {
+    if constexpr (std::is_same_v<T, linum::dd>) return static_cast<long double>(x.hi) + x.lo;
+    else return static_cast<long double>(static_cast<double>(x));
+}
+
+template <>
+long double widen(const long double& x) {
+    return x;
+}
+
+template <typename T>
+static T (*backend_kernel(const std::string& name))(T, T) {
+    using K = linum::Kernels<T>;
+    if (name == "sin") return [](T x, T) { return K::sin(x); };
+    if (name == "cos") return [](T x, T) { return K::cos(x); };
+    if (name == "tan") return [](T x, T) { return K::tan(x); };
+    if (name == "sqrt") return [](T x, T) { return K::sqrt(x); };
+    if (name == "ln") return [](T x, T) { return K::ln(x); };
+    if (name == "log") return [](T base, T x) { return K::log(base, x); };
+    return [](T x, T y) { return K::pow(x, y); };
+}
+
+// The reference sees the inputs after rounding to T, so only the kernel's
+// own error is counted.
+template <typename T>
+static BackendResult measure_backend(const std::string& backend, const BackendCase& math_case, const std::vector<double>& xs,
+                                     const std::vector<double>& ys, double min_time) {
+    T (*kernel)(T, T) = backend_kernel<T>(math_case.name);
+    std::vector<T> tx(xs.begin(), xs.end()), ty(ys.begin(), ys.end());
+    BackendResult result{math_case.name, backend, math_case.domain.name};
+    for (size_t i = 0; i < tx.size(); i++) {
+        long double ref = math_case.reference(widen(tx[i]), widen(ty[i]));
+        if (!std::isfinite(static_cast<double>(ref))) continue;
+        long double err = std::fabs(widen(kernel(tx[i], ty[i])) - ref) / std::max(1.0L, std::fabs(ref));
+        result.max_err = std::max(result.max_err, static_cast<double>(err));
+    }
+    result.mevals = mevals_per_s(tx.size(), min_time, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < tx.size(); i++) sum += static_cast<double>(kernel(tx[i], ty[i]));
+        keep(sum);
+    });
+    return result;
+}
+
+static void usage() {
+    std::cout << "Usage: ./math_accuracy [options]\n"
+              << "  --samples <n>          accuracy samples per function and domain (default: 200000)\n"
+              << "  --min-time <seconds>   minimum timing per measurement (default: 0.2)\n"
+              << "  --json <file>          write machine-readable results\n"
+              << "  --check                fail unless precise stays within " << precise_max_ulp << " ulp and fast within 1e-6,\n"
+              << "                         and each numeric backend within the bound for its type" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t samples = 200000;
+    double min_time = 0.2;
+    bool check = false;
+    std::string json_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--check") {
+            check = true;
+        }
+        else if ((arg == "--samples" || arg == "--min-time" || arg == "--json") && i + 1 < argc) {
+            std::string value = argv[++i];
+            if (arg == "--samples") samples = std::stoull(value);
+            else if (arg == "--min-time") min_time = std::stod(value);
+            else json_path = value;
+        }
+        else {
+            usage();
+            return arg == "-h" || arg == "--help" ? 0 : EXIT_FAILURE;
+        }
+    }
+
+    std::vector<CaseResult> results;
+    std::vector<double> xs(samples), ys(samples), out(samples);
+    bool ok = true;
+
+    for (const auto& math_case : cases()) {
+        for (const auto& domain : math_case.domains) {
+            std::mt19937_64 rng(1234);
+            for (size_t i = 0; i < samples; i++) {
+                xs[i] = domain.x(rng);
+                ys[i] = domain.y ? domain.y(rng) : 0.0;
+            }
+
+            for (const auto& tier : math_case.tiers) {
+                // Scalar and batch forms may use different kernels, so the
+                // error columns are the worse of the two.
+                CaseResult result{math_case.name, tier.name, domain.name};
+                auto measure = [&](size_t i, double got) {
+                    long double ref = math_case.reference(xs[i], ys[i]);
+                    if (!std::isfinite(static_cast<double>(ref)) || ref == 0) return;
+                    double err = std::fabs(static_cast<double>(got - ref));
+                    result.max_ulp = std::max(result.max_ulp, err / ulp(static_cast<double>(ref)));
+                    result.max_rel = std::max(result.max_rel, err / std::fabs(static_cast<double>(ref)));
+                };
+                for (size_t i = 0; i < samples; i++) measure(i, tier.scalar(xs[i], ys[i]));
+
+                result.scalar_mevals = mevals_per_s(samples, min_time, [&] {
+                    double sum = 0;
+                    for (size_t i = 0; i < samples; i++) sum += tier.scalar(xs[i], ys[i]);
+                    keep(sum);
+                });
+                if (tier.batch) {
+                    std::fill(out.begin(), out.end(), 0.0);
+                    tier.batch(xs.data(), out.data(), samples);
+                    for (size_t i = 0; i < samples; i++) measure(i, out[i]);
+                    result.batch_mevals = mevals_per_s(samples, min_time, [&] {
+                        tier.batch(xs.data(), out.data(), samples);
+                        keep(out[samples / 2]);
+                    });
+                }
+
+                if (check && ((tier.name == "precise" && result.max_ulp > precise_max_ulp) || (tier.name == "fast" && result.max_rel > 1e-6))) {
+                    std::cerr << "Error: " << math_case.name << " " << tier.name << " on " << domain.name
+                              << " exceeds its accuracy bound (" << result.max_ulp << " ulp, " << result.max_rel << " rel)" << std::endl;
+                    ok = false;
+                }
+                results.push_back(result);
+            }
+        }
+    }
+
+    // Bounds are a few units of each type's precision, so a regression in a
+    // kernel shows up without the table having to be read. long double is
+    // also the reference, so its rows only say what it costs.
+    struct Backend
+    {
+        std::string name;
+        double bound;
+        BackendResult (*measure)(const std::string&, const BackendCase&, const std::vector<double>&, const std::vector<double>&, double);
+    };
+    const std::vector<Backend> backends = {
+        {"float32", 1e-6, measure_backend<float>},
+        {"float64", 1e-15, measure_backend<double>},
+        {"long-double", 1e-18, measure_backend<long double>},
+        {"q16.16", 1e-4, measure_backend<linum::Q16>},
+        {"double-double", 1e-18, measure_backend<linum::dd>},
+    };
+    std::vector<BackendResult> backend_results;
+    for (const auto& math_case : backend_cases()) {
+        std::mt19937_64 rng(1234);
+        for (size_t i = 0; i < samples; i++) {
+            xs[i] = math_case.domain.x(rng);
+            ys[i] = math_case.domain.y ? math_case.domain.y(rng) : 0.0;
+        }
+        for (const auto& backend : backends) {
+            BackendResult result = backend.measure(backend.name, math_case, xs, ys, min_time);
+            if (check && !(result.max_err <= backend.bound)) {
+                std::cerr << "Error: " << math_case.name << " " << backend.name << " on " << math_case.domain.name
+                          << " exceeds its accuracy bound (" << result.max_err << ")" << std::endl;
+                ok = false;
+            }
+            backend_results.push_back(result);
+        }
+    }
+
+    std::cout << std::left << std::setw(6) << "fn" << std::setw(9) << "tier" << std::setw(30) << "domain" << std::right
+              << std::setw(12) << "max ulp" << std::setw(12) << "max rel" << std::setw(14) << "Mevals/s" << std::setw(14) << "batch" << std::endl;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(6) << r.function << std::setw(9) << r.tier << std::setw(30) << r.domain << std::right
+                  << std::setw(12) << std::setprecision(3) << r.max_ulp << std::setw(12) << r.max_rel
+                  << std::setw(14) << std::fixed << std::setprecision(1) << r.scalar_mevals << std::setw(14);
+        if (r.batch_mevals > 0) std::cout << r.batch_mevals; else std::cout << "-";
+        std::cout << std::defaultfloat << std::endl;
+    }
+
+    std::cout << "\n" << std::left << std::setw(6) << "fn" << std::setw(15) << "backend" << std::setw(30) << "domain" << std::right
+              << std::setw(12) << "max err" << std::setw(14) << "Mevals/s" << std::endl;
+    for (const auto& r : backend_results) {
+        std::cout << std::left << std::setw(6) << r.function << std::setw(15) << r.backend << std::setw(30) << r.domain << std::right
+                  << std::setw(12) << std::setprecision(3) << r.max_err
+                  << std::setw(14) << std::fixed << std::setprecision(1) << r.mevals << std::defaultfloat << std::endl;
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream json(json_path);
+        json << std::setprecision(10);
+        json << "{\n  \"version\": \"" << LI_VERSION << "\",\n  \"samples\": " << samples << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& r = results[i];
+            json << "    {\"function\": \"" << r.function << "\", \"tier\": \"" << r.tier << "\", \"domain\": \"" << r.domain
+                 << "\", \"max_ulp\": " << r.max_ulp << ", \"max_rel\": " << r.max_rel
+                 << ", \"scalar_mevals_per_s\": " << r.scalar_mevals << ", \"batch_mevals_per_s\": " << r.batch_mevals << "}"
+                 << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        json << "  ],\n  \"backends\": [\n";
+        for (size_t i = 0; i < backend_results.size(); i++) {
+            const auto& r = backend_results[i];
+            json << "    {\"function\": \"" << r.function << "\", \"backend\": \"" << r.backend << "\", \"domain\": \"" << r.domain
+                 << "\", \"max_err\": " << r.max_err << ", \"mevals_per_s\": " << r.mevals << "}"
+                 << (i + 1 < backend_results.size() ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+    }
+
+    return ok ? 0 : EXIT_FAILURE;
+}
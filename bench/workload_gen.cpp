@@ -0,0 +1,68 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Workload.hpp"
+
+static void usage() {
+    std::cout << "Usage: ./workload_gen [options]\n"
+              << "  -o <file>              output path (default: stdout)\n"
+              << "  --statements <n>       minimum number of statements (default: 1000)\n"
+              << "  --bytes <n>            keep generating until the program is at least n bytes\n"
+              << "  --depth <n>            maximum nesting depth of groups and builtins (default: 4)\n"
+              << "  --terms <n>            maximum binary operators per expression (default: 4)\n"
+              << "  --builtin-ratio <p>    probability an expression starts with a builtin (default: 0.3)\n"
+              << "  --builtins <mix>       weighted builtin mix, e.g. sin=3,cos=3,pow=1\n"
+              << "  --fin-ratio <p>        probability a statement is a fin (default: 0.05)\n"
+              << "  --int-ratio <p>        probability a declaration is an int (default: 0.3)\n"
+              << "  --seed <n>             random seed (default: 42)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    WorkloadConfig config;
+    std::string output_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string value = argv[++i];
+        if (arg == "-o") output_path = value;
+        else if (arg == "--statements") config.statements = std::stoull(value);
+        else if (arg == "--bytes") config.target_bytes = std::stoull(value);
+        else if (arg == "--depth") config.max_depth = std::stoi(value);
+        else if (arg == "--terms") config.terms = std::stoi(value);
+        else if (arg == "--builtin-ratio") config.builtin_ratio = std::stod(value);
+        else if (arg == "--fin-ratio") config.fin_ratio = std::stod(value);
+        else if (arg == "--int-ratio") config.int_ratio = std::stod(value);
+        else if (arg == "--seed") config.seed = std::stoull(value);
+        else if (arg == "--builtins") {
+            if (!WorkloadGenerator::set_builtin_mix(config, value)) {
+                std::cerr << "Error: Invalid builtin mix '" << value << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    WorkloadGenerator generator(config);
+    std::string program = generator.generate();
+    if (output_path.empty()) {
+        std::cout << program;
+    }
+    else {
+        std::ofstream file(output_path);
+        file << program;
+    }
+    return 0;
+}
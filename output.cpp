@@ -7,7 +7,7 @@ double customlog(double base, double x) {
 
 int main() {
 	std::srand(std::time(NULL));
-	float x =  std::rand()%(10.0-1.0+1)+1.0;
+	float x =  std::rand()%(10-1+1)+1;
 	std::cout <<  x << std::endl;
 
 	return 0;
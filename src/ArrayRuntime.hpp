@@ -0,0 +1,176 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "MathKernels.hpp"
+
+// Runtime behind `float[]` values. An Array is one contiguous buffer of
+// doubles; every operator and builtin is a flat loop over it, with scalars
+// broadcast across all elements. Binary operators take their left operand by
+// value so chained expressions reuse the temporary's buffer.
+//
+// Like the math kernels, the source is compiled here (for the evaluator) and
+// kept as text for the generator to emit into programs that use arrays.
+#define LI_ARRAY_RUNTIME(...) __VA_ARGS__ inline constexpr const char* array_runtime_source = #__VA_ARGS__;
+
+LI_ARRAY_RUNTIME(
+namespace li {
+
+struct Array
+{
+    std::vector<double> data;
+
+    size_t size() const { return data.size(); }
+    double& operator[](size_t i) { return data[i]; }
+    double operator[](size_t i) const { return data[i]; }
+};
+
+template <typename T>
+using if_scalar = std::enable_if_t<std::is_arithmetic_v<T>, int>;
+
+inline void check_length(const Array& a, const Array& b) {
+    if (a.size() != b.size()) {
+        throw std::length_error("array length mismatch: " + std::to_string(a.size()) + " vs " + std::to_string(b.size()));
+    }
+}
+
+template <typename... T>
+inline Array array(T... values) {
+    return Array{std::vector<double>{static_cast<double>(values)...}};
+}
+
+inline Array linspace(double start, double stop, double count) {
+    if (!(count >= 0) || count > 1e9) throw std::length_error("linspace count out of range");
+    size_t n = static_cast<size_t>(count);
+    Array out{std::vector<double>(n)};
+    double step = n > 1 ? (stop - start) / static_cast<double>(n - 1) : 0.0;
+    for (size_t i = 0; i < n; i++) out.data[i] = start + step * static_cast<double>(i);
+    if (n > 1) out.data[n - 1] = stop;
+    return out;
+}
+
+inline Array range(double start, double stop) {
+    double count = std::ceil(stop - start);
+    if (!(count <= 1e9)) throw std::length_error("range length out of range");
+    size_t n = count > 0 ? static_cast<size_t>(count) : 0;
+    Array out{std::vector<double>(n)};
+    for (size_t i = 0; i < n; i++) out.data[i] = start + static_cast<double>(i);
+    return out;
+}
+
+template <typename F>
+inline Array map(Array a, F f) {
+    double* __restrict d = a.data.data();
+    for (size_t i = 0, n = a.size(); i < n; i++) d[i] = f(d[i]);
+    return a;
+}
+
+template <typename F>
+inline Array zip(Array a, const Array& b, F f) {
+    check_length(a, b);
+    double* __restrict d = a.data.data();
+    const double* __restrict e = b.data.data();
+    for (size_t i = 0, n = a.size(); i < n; i++) d[i] = f(d[i], e[i]);
+    return a;
+}
+
+inline Array batch(const Array& a, void (*kernel)(const double*, double*, size_t)) {
+    Array out{std::vector<double>(a.size())};
+    kernel(a.data.data(), out.data.data(), a.size());
+    return out;
+}
+
+inline Array operator+(Array a, const Array& b) { return zip(std::move(a), b, [](double x, double y) { return x + y; }); }
+inline Array operator-(Array a, const Array& b) { return zip(std::move(a), b, [](double x, double y) { return x - y; }); }
+inline Array operator*(Array a, const Array& b) { return zip(std::move(a), b, [](double x, double y) { return x * y; }); }
+inline Array operator/(Array a, const Array& b) { return zip(std::move(a), b, [](double x, double y) { return x / y; }); }
+inline Array operator%(Array a, const Array& b) { return zip(std::move(a), b, [](double x, double y) { return std::fmod(x, y); }); }
+
+template <typename S, if_scalar<S> = 0> inline Array operator+(Array a, S s) { double v = s; return map(std::move(a), [v](double x) { return x + v; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator-(Array a, S s) { double v = s; return map(std::move(a), [v](double x) { return x - v; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator*(Array a, S s) { double v = s; return map(std::move(a), [v](double x) { return x * v; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator/(Array a, S s) { double v = s; return map(std::move(a), [v](double x) { return x / v; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator%(Array a, S s) { double v = s; return map(std::move(a), [v](double x) { return std::fmod(x, v); }); }
+template <typename S, if_scalar<S> = 0> inline Array operator+(S s, Array a) { double v = s; return map(std::move(a), [v](double x) { return v + x; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator-(S s, Array a) { double v = s; return map(std::move(a), [v](double x) { return v - x; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator*(S s, Array a) { double v = s; return map(std::move(a), [v](double x) { return v * x; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator/(S s, Array a) { double v = s; return map(std::move(a), [v](double x) { return v / x; }); }
+template <typename S, if_scalar<S> = 0> inline Array operator%(S s, Array a) { double v = s; return map(std::move(a), [v](double x) { return std::fmod(v, x); }); }
+
+inline Array sqrt(Array a) { return map(std::move(a), [](double x) { return std::sqrt(x); }); }
+inline Array abs(Array a) { return map(std::move(a), [](double x) { return std::fabs(x); }); }
+inline Array sin(Array a) { return map(std::move(a), [](double x) { return std::sin(x); }); }
+inline Array cos(Array a) { return map(std::move(a), [](double x) { return std::cos(x); }); }
+inline Array tan(Array a) { return map(std::move(a), [](double x) { return std::tan(x); }); }
+inline Array ln(Array a) { return map(std::move(a), [](double x) { return std::log(x); }); }
+inline Array sin_precise(const Array& a) { return batch(a, limath::sin_precise_n); }
+inline Array sin_fast(const Array& a) { return batch(a, limath::sin_fast_n); }
+inline Array cos_precise(const Array& a) { return batch(a, limath::cos_precise_n); }
+inline Array cos_fast(const Array& a) { return batch(a, limath::cos_fast_n); }
+inline Array tan_precise(const Array& a) { return batch(a, limath::tan_precise_n); }
+inline Array tan_fast(const Array& a) { return batch(a, limath::tan_fast_n); }
+inline Array ln_precise(const Array& a) { return batch(a, limath::ln_precise_n); }
+inline Array ln_fast(const Array& a) { return batch(a, limath::ln_fast_n); }
+
+// Two-argument builtins broadcast whichever side is scalar.
+inline Array broadcast(double v, const Array& like) { return Array{std::vector<double>(like.size(), v)}; }
+inline const Array& broadcast(const Array& a, const Array&) { return a; }
+
+template <typename A, typename B>
+inline const Array& shape_of(const A& a, const B& b) {
+    if constexpr (std::is_same_v<A, Array>) return a; else return b;
+}
+
+template <typename A, typename B, typename F>
+inline Array zip_any(const A& a, const B& b, F f) {
+    const Array& like = shape_of(a, b);
+    return zip(Array(broadcast(a, like)), broadcast(b, like), f);
+}
+
+template <typename A, typename B> inline Array pow(const A& a, const B& b) { return zip_any(a, b, [](double x, double y) { return std::pow(x, y); }); }
+template <typename A, typename B> inline Array pow_precise(const A& a, const B& b) { return zip_any(a, b, limath::pow_precise); }
+template <typename A, typename B> inline Array pow_fast(const A& a, const B& b) { return zip_any(a, b, limath::pow_fast); }
+template <typename A, typename B> inline Array log(const A& base, const B& x) { return zip_any(base, x, [](double b, double v) { return std::log(v) / std::log(b); }); }
+template <typename A, typename B> inline Array log_precise(const A& base, const B& x) { return zip_any(base, x, limath::log_precise); }
+template <typename A, typename B> inline Array log_fast(const A& base, const B& x) { return zip_any(base, x, limath::log_fast); }
+
+inline double sum(const Array& a) {
+    double total = 0;
+    for (size_t i = 0, n = a.size(); i < n; i++) total += a.data[i];
+    return total;
+}
+
+inline double dot(const Array& a, const Array& b) {
+    check_length(a, b);
+    double total = 0;
+    for (size_t i = 0, n = a.size(); i < n; i++) total += a.data[i] * b.data[i];
+    return total;
+}
+
+inline double max(const Array& a) {
+    double best = -INFINITY;
+    for (size_t i = 0, n = a.size(); i < n; i++) best = a.data[i] > best ? a.data[i] : best;
+    return best;
+}
+
+inline double min(const Array& a) {
+    double best = INFINITY;
+    for (size_t i = 0, n = a.size(); i < n; i++) best = a.data[i] < best ? a.data[i] : best;
+    return best;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const Array& a) {
+    out << "[";
+    for (size_t i = 0; i < a.size(); i++) {
+        if (i) out << ", ";
+        out << a.data[i];
+    }
+    return out << "]";
+}
+
+}
+)
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// A problem in a source file at a 1-based line and column.
+struct Diagnostic
+{
+    size_t line;
+    size_t column;
+    std::string message;
+};
+
+// Prints in the usual `file:line:column: error: message` form so editors and
+// CI log parsers pick it up.
+inline void print_diagnostic(std::ostream& out, const std::string& path, const Diagnostic& diagnostic) {
+    out << path << ":" << diagnostic.line << ":" << diagnostic.column << ": error: " << diagnostic.message << "\n";
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cerrno>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+
+// Output sink for the generator. Text is appended to a reusable block that is
+// written to the file descriptor whenever it fills up, so memory use stays at
+// one block regardless of program size. Without a descriptor the block simply
+// grows and holds the whole output.
+class Emitter {
+public:
+    static constexpr size_t block_size = 1 << 18;
+
+    Emitter() { m_buffer.reserve(block_size); }
+    explicit Emitter(int fd) : m_fd(fd) { m_buffer.reserve(block_size); }
+
+    Emitter(const Emitter&) = delete;
+    Emitter& operator=(const Emitter&) = delete;
+
+    ~Emitter() { flush(); }
+
+    Emitter& operator<<(std::string_view text) {
+        m_buffer.append(text);
+        if (m_buffer.size() >= block_size) flush_block();
+        return *this;
+    }
+
+    Emitter& operator<<(const std::string& text) { return *this << std::string_view(text); }
+    Emitter& operator<<(const char* text) { return *this << std::string_view(text); }
+
+    Emitter& operator<<(char c) {
+        m_buffer.push_back(c);
+        if (m_buffer.size() >= block_size) flush_block();
+        return *this;
+    }
+
+    template <typename T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>, int> = 0>
+    Emitter& operator<<(T value) {
+        char digits[64];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        return *this << std::string_view(digits, result.ptr - digits);
+    }
+
+    bool flush() {
+        if (m_fd >= 0) flush_block();
+        return !m_failed;
+    }
+
+    bool failed() const { return m_failed; }
+
+    std::string take() {
+        std::string out;
+        out.swap(m_buffer);
+        return out;
+    }
+
+private:
+    int m_fd = -1;
+    bool m_failed = false;
+    std::string m_buffer;
+
+    void flush_block() {
+        if (m_fd < 0) return;
+        const char* data = m_buffer.data();
+        size_t left = m_buffer.size();
+        while (left > 0 && !m_failed) {
+            ssize_t written = ::write(m_fd, data, left);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                m_failed = true;
+                break;
+            }
+            data += written;
+            left -= written;
+        }
+        m_buffer.clear();
+    }
+};
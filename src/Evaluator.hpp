@@ -0,0 +1,695 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include "Parser.hpp"
+#include "Precompiled.hpp"
+#include "MathKernels.hpp"
+#include "ArrayRuntime.hpp"
+#include "NumericBackends.hpp"
+
+// Runs a precompiled program in process instead of generating and compiling
+// C++. Values keep the types the generated program would give them: int and
+// float variables, double literals, and the std:: overload each builtin would
+// resolve to, with the usual arithmetic conversions between them. float[]
+// values run on the same li:: runtime the generator emits, compiled here with
+// the tool's own flags.
+//
+// Operator nodes are chained left to right without precedence; the generator
+// prints a chain flat and leaves precedence to the C++ compiler. The evaluator
+// therefore flattens chains the same way and applies C++ precedence itself.
+//
+// Under a numeric backend the non-int scalars are all that backend's type,
+// and builtins run its linum:: kernels, as the generated program would.
+using Value = std::variant<int, float, double, long double, linum::Q16, linum::dd, li::Array>;
+
+// Budgets for running formulas that are not trusted. Zero means unlimited.
+// Steps count evaluated nodes plus one per array element produced, depth is
+// the nesting of the node being evaluated, and memory is the array data held
+// by variables and by the temporaries of the statement being run.
+struct EvalLimits
+{
+    uint64_t max_steps = 0;
+    uint64_t max_time_ms = 0;
+    uint32_t max_depth = 0;
+    uint32_t max_nodes = 0;
+    uint64_t max_memory = 0;
+
+    static EvalLimits sandbox() {
+        return EvalLimits{10'000'000, 1000, 200, 100'000, 64ull << 20};
+    }
+};
+
+enum class EvalErrorKind { Runtime, StepLimit, TimeLimit, DepthLimit, NodeLimit, MemoryLimit };
+
+struct EvalError
+{
+    EvalErrorKind kind;
+    std::string message;
+};
+
+inline const char* eval_error_name(EvalErrorKind kind) {
+    switch (kind) {
+        case EvalErrorKind::StepLimit: return "step limit";
+        case EvalErrorKind::TimeLimit: return "time limit";
+        case EvalErrorKind::DepthLimit: return "depth limit";
+        case EvalErrorKind::NodeLimit: return "node limit";
+        case EvalErrorKind::MemoryLimit: return "memory limit";
+        default: return "runtime error";
+    }
+}
+
+class Evaluator {
+public:
+    Evaluator(const PrecompiledAst& ast)
+        : m_ast(ast), m_vars(ast.string_count()), m_literals(ast.string_count()), m_bound(ast.string_count()), m_rng(std::random_device{}()) {}
+
+    // Tier for builtins that carry no tier of their own.
+    void set_math_tier(MathTier tier) { m_math_tier = tier; }
+
+    void set_numeric(NumericBackend backend) { m_numeric = backend; }
+
+    void set_limits(const EvalLimits& limits) { m_limits = limits; }
+
+    // Evaluates every statement, writing what `fin` prints to `out`. Returns
+    // false on the first runtime error or exceeded limit, which error() then
+    // describes.
+    bool run(std::ostream& out) {
+        if (!start()) return false;
+        for (uint32_t i = 0; i < m_ast.stmt_count(); i++) {
+            if (!run_statement(i, out)) return false;
+            if (m_ast.stmt(i).kind == PrecompiledStmtKind::Exit) out << "\n";
+        }
+        return true;
+    }
+
+    // Restarts the budgets; false if the program is too large to run at all.
+    bool start() {
+        m_steps = 0;
+        m_next_clock_check = 0;
+        m_start = std::chrono::steady_clock::now();
+        return guarded([&] {
+            if (m_limits.max_nodes && m_ast.node_count() > m_limits.max_nodes) {
+                fail(EvalErrorKind::NodeLimit, "program has " + std::to_string(m_ast.node_count()) + " nodes, the limit is " + std::to_string(m_limits.max_nodes));
+            }
+            if (m_numeric != NumericBackend::Default && m_ast.uses_arrays()) {
+                fail("float[] values need the default numeric backend");
+            }
+        });
+    }
+
+    // Runs statement `i` against the variables declared so far. A `fin`
+    // writes its value without a line break.
+    bool run_statement(uint32_t i, std::ostream& out) {
+        m_temp_bytes = 0;
+        return guarded([&] { run_stmt(m_ast.stmt(i), out); });
+    }
+
+    // Declarations of `name` take `value` instead of evaluating their initializer.
+    void bind(uint32_t name, double value) { m_bound[name] = value; }
+
+    // Undeclares `name` so its declaration can run again.
+    void forget(uint32_t name) {
+        if (auto array = m_vars[name].has_value() ? std::get_if<li::Array>(&m_vars[name].value()) : nullptr) {
+            m_var_bytes -= array->size() * sizeof(double);
+        }
+        m_vars[name].reset();
+    }
+
+    void seed(uint32_t seed) { m_rng.seed(seed); }
+
+    const EvalError& error() const { return m_error; }
+
+private:
+    struct DepthGuard
+    {
+        uint32_t& depth;
+        ~DepthGuard() { depth--; }
+    };
+
+    template <typename T>
+    static constexpr bool is_array_v = std::is_same_v<std::decay_t<T>, li::Array>;
+
+    // Q16 and dd: only reachable under their backend, never by libm calls.
+    template <typename T>
+    static constexpr bool is_backend_class_v = std::is_class_v<std::decay_t<T>> && !is_array_v<T>;
+
+    const PrecompiledAst& m_ast;
+    std::vector<std::optional<Value>> m_vars;
+    std::vector<std::optional<Value>> m_literals;
+    std::vector<std::optional<double>> m_bound;
+    MathTier m_math_tier = MathTier::Default;
+    NumericBackend m_numeric = NumericBackend::Default;
+    std::minstd_rand m_rng;
+    EvalError m_error{EvalErrorKind::Runtime, ""};
+    EvalLimits m_limits;
+    uint64_t m_steps = 0;
+    uint64_t m_next_clock_check = 0;
+    uint32_t m_depth = 0;
+    uint64_t m_var_bytes = 0;
+    uint64_t m_temp_bytes = 0;
+    std::chrono::steady_clock::time_point m_start;
+
+    template <typename F>
+    bool guarded(F f) {
+        try {
+            f();
+        }
+        catch (const EvalError& e) {
+            m_error = e;
+            return false;
+        }
+        catch (const std::bad_alloc&) {
+            m_error = EvalError{EvalErrorKind::MemoryLimit, "out of memory"};
+            return false;
+        }
+        catch (const std::exception& e) {
+            m_error = EvalError{EvalErrorKind::Runtime, e.what()};
+            return false;
+        }
+        return true;
+    }
+
+    [[noreturn]] static void fail(std::string message) {
+        throw EvalError{EvalErrorKind::Runtime, std::move(message)};
+    }
+
+    [[noreturn]] static void fail(EvalErrorKind kind, std::string message) {
+        throw EvalError{kind, std::move(message)};
+    }
+
+    // The clock is only read every few thousand steps.
+    void step(uint64_t count) {
+        m_steps += count;
+        if (m_limits.max_steps && m_steps > m_limits.max_steps) {
+            fail(EvalErrorKind::StepLimit, "exceeded " + std::to_string(m_limits.max_steps) + " steps");
+        }
+        if (m_limits.max_time_ms && m_steps >= m_next_clock_check) {
+            m_next_clock_check = m_steps + 4096;
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count();
+            if (uint64_t(elapsed) > m_limits.max_time_ms) {
+                fail(EvalErrorKind::TimeLimit, "exceeded " + std::to_string(m_limits.max_time_ms) + " ms");
+            }
+        }
+    }
+
+    // Checked before an array of `count` elements is built from scalars, so
+    // an oversized linspace or range fails without allocating.
+    void reserve(double count) {
+        if (m_limits.max_memory && count * sizeof(double) > double(m_limits.max_memory - std::min(m_limits.max_memory, m_var_bytes + m_temp_bytes))) {
+            fail(EvalErrorKind::MemoryLimit, "array of " + std::to_string(static_cast<uint64_t>(count)) + " elements exceeds " + std::to_string(m_limits.max_memory) + " bytes");
+        }
+    }
+
+    // Every array a node produces is charged to the current statement.
+    // Element-wise operations often reuse a temporary's buffer, so this
+    // overestimates the peak rather than missing any of it.
+    void charge(const li::Array& array) {
+        step(array.size());
+        m_temp_bytes += array.size() * sizeof(double);
+        if (m_limits.max_memory && m_var_bytes + m_temp_bytes > m_limits.max_memory) {
+            fail(EvalErrorKind::MemoryLimit, "arrays exceed " + std::to_string(m_limits.max_memory) + " bytes");
+        }
+    }
+
+    void run_stmt(const PrecompiledStmt& stmt, std::ostream& out) {
+        switch (stmt.kind) {
+            case PrecompiledStmtKind::Exit: {
+                Value value = eval(stmt.a);
+                std::streamsize precision = out.precision();
+                if (m_numeric != NumericBackend::Default) out.precision(backend_digits());
+                std::visit([&](const auto& v) { out << v; }, value);
+                out.precision(precision);
+                break;
+            }
+            case PrecompiledStmtKind::VarInt:
+                declare(stmt.name, to_int(initializer(stmt)));
+                break;
+            case PrecompiledStmtKind::VarFloat:
+                if (m_numeric != NumericBackend::Default) {
+                    Value value = initializer(stmt);
+                    declare(stmt.name, with_backend([&](auto tag) -> Value { return to_backend<decltype(tag)>(value, "float variable"); }));
+                }
+                else {
+                    declare(stmt.name, static_cast<float>(to_double(initializer(stmt), "float variable")));
+                }
+                break;
+            case PrecompiledStmtKind::VarArray: {
+                Value value = eval(stmt.a);
+                if (!std::holds_alternative<li::Array>(value)) fail(std::string(m_ast.string(stmt.name)) + " is declared float[] but assigned a scalar");
+                declare(stmt.name, std::move(value));
+                break;
+            }
+            case PrecompiledStmtKind::Pow:
+                pow(static_cast<MathTier>(stmt.tier), eval(stmt.a), eval(stmt.b));
+                break;
+        }
+    }
+
+    Value initializer(const PrecompiledStmt& stmt) {
+        if (m_bound[stmt.name].has_value()) return m_bound[stmt.name].value();
+        return eval(stmt.a);
+    }
+
+    void declare(uint32_t name, Value value) {
+        if (m_vars[name].has_value()) fail(std::string(m_ast.string(name)) + " is already declared");
+        if (auto array = std::get_if<li::Array>(&value)) m_var_bytes += array->size() * sizeof(double);
+        m_vars[name] = std::move(value);
+    }
+
+    DepthGuard descend() {
+        if (m_limits.max_depth && m_depth >= m_limits.max_depth) {
+            fail(EvalErrorKind::DepthLimit, "expression nesting exceeds " + std::to_string(m_limits.max_depth));
+        }
+        m_depth++;
+        return DepthGuard{m_depth};
+    }
+
+    Value eval(uint32_t index) {
+        step(1);
+        DepthGuard guard = descend();
+        Value value = eval_node(index);
+        if (auto array = std::get_if<li::Array>(&value)) charge(*array);
+        return value;
+    }
+
+    Value eval_node(uint32_t index) {
+        const PrecompiledNode& n = m_ast.node(index);
+        switch (n.kind) {
+            case PrecompiledKind::IntLit: return literal(n.a);
+            case PrecompiledKind::Identifier:
+                if (!m_vars[n.a].has_value()) fail(std::string(m_ast.string(n.a)) + " is not declared");
+                return m_vars[n.a].value();
+            case PrecompiledKind::Plus:
+            case PrecompiledKind::Minus:
+            case PrecompiledKind::Times:
+            case PrecompiledKind::Division:
+            case PrecompiledKind::Mod:
+            case PrecompiledKind::Rand: {
+                Chain chain;
+                flatten(index, chain);
+                return reduce(std::move(chain));
+            }
+            case PrecompiledKind::Grouped: return eval(n.a);
+            case PrecompiledKind::Pow: return pow(static_cast<MathTier>(n.tier), eval(n.a), eval(n.b));
+            case PrecompiledKind::Sqrt:
+                if (backend_kernels(MathTier::Exact)) return backend_math([](auto k, auto x) { return k.sqrt(x); }, eval(n.a));
+                return std::visit([](auto&& x) -> Value {
+                    if constexpr (is_array_v<decltype(x)>) return li::sqrt(std::move(x));
+                    else if constexpr (is_backend_class_v<decltype(x)>) fail("numeric backend value in a native builtin");
+                    else return std::sqrt(x);
+                }, eval(n.a));
+            case PrecompiledKind::Abs:
+                return std::visit([](auto&& x) -> Value {
+                    if constexpr (is_array_v<decltype(x)>) return li::abs(std::move(x));
+                    else return linum::abs(x);
+                }, eval(n.a));
+            case PrecompiledKind::Sin:
+                if (backend_kernels(static_cast<MathTier>(n.tier))) return backend_math([](auto k, auto x) { return k.sin(x); }, eval(n.a));
+                return unary_math(n, [](auto x) { return std::sin(x); }, li::sin, limath::sin_precise, limath::sin_fast, li::sin_precise, li::sin_fast);
+            case PrecompiledKind::Cos:
+                if (backend_kernels(static_cast<MathTier>(n.tier))) return backend_math([](auto k, auto x) { return k.cos(x); }, eval(n.a));
+                return unary_math(n, [](auto x) { return std::cos(x); }, li::cos, limath::cos_precise, limath::cos_fast, li::cos_precise, li::cos_fast);
+            case PrecompiledKind::Tan:
+                if (backend_kernels(static_cast<MathTier>(n.tier))) return backend_math([](auto k, auto x) { return k.tan(x); }, eval(n.a));
+                return unary_math(n, [](auto x) { return std::tan(x); }, li::tan, limath::tan_precise, limath::tan_fast, li::tan_precise, li::tan_fast);
+            case PrecompiledKind::Ln:
+                if (backend_kernels(static_cast<MathTier>(n.tier))) return backend_math([](auto k, auto x) { return k.ln(x); }, eval(n.a));
+                return unary_math(n, [](auto x) { return std::log(x); }, li::ln, limath::ln_precise, limath::ln_fast, li::ln_precise, li::ln_fast);
+            case PrecompiledKind::Log:
+                if (backend_kernels(static_cast<MathTier>(n.tier))) {
+                    Value base = eval(n.a);
+                    return backend_math([](auto k, auto b, auto x) { return k.log(b, x); }, base, eval(n.b));
+                }
+                return log(n);
+            case PrecompiledKind::Linspace: {
+                double start = to_double(eval(m_ast.operand(n.a)), "linspace");
+                double stop = to_double(eval(m_ast.operand(n.a + 1)), "linspace");
+                double count = to_double(eval(m_ast.operand(n.a + 2)), "linspace");
+                reserve(count);
+                return li::linspace(start, stop, count);
+            }
+            case PrecompiledKind::Range: {
+                double start = to_double(eval(n.a), "range");
+                double stop = to_double(eval(n.b), "range");
+                reserve(std::ceil(stop - start));
+                return li::range(start, stop);
+            }
+            case PrecompiledKind::ArrayLit: {
+                reserve(n.b);
+                li::Array array;
+                array.data.reserve(n.b);
+                for (uint32_t i = 0; i < n.b; i++) {
+                    array.data.push_back(to_double(eval(m_ast.operand(n.a + i)), "array element"));
+                }
+                return array;
+            }
+            case PrecompiledKind::Sum: return li::sum(to_array(eval(n.a), "sum"));
+            case PrecompiledKind::Max: return li::max(to_array(eval(n.a), "max"));
+            case PrecompiledKind::Min: return li::min(to_array(eval(n.a), "min"));
+            case PrecompiledKind::Dot: {
+                li::Array left = to_array(eval(n.a), "dot");
+                return li::dot(left, to_array(eval(n.b), "dot"));
+            }
+        }
+        fail("unknown node kind");
+    }
+
+    struct Chain
+    {
+        std::vector<Value> operands;
+        std::vector<PrecompiledKind> operators;
+    };
+
+    static bool is_chain(PrecompiledKind kind) {
+        return kind == PrecompiledKind::Plus || kind == PrecompiledKind::Minus || kind == PrecompiledKind::Times
+            || kind == PrecompiledKind::Division || kind == PrecompiledKind::Mod || kind == PrecompiledKind::Rand;
+    }
+
+    // Appends the operands and operators the generator prints for `index`.
+    // A unary minus prints as `0-x`, and rand(a, b) as the unparenthesised
+    // `std::rand()%(b-a+1)+a`. Chains nest on their left operand, so the
+    // left spine is walked in a loop and a long chain does not count as deep.
+    void flatten(uint32_t index, Chain& chain) {
+        std::vector<uint32_t> spine;
+        while (is_chain(m_ast.node(index).kind) && m_ast.node(index).kind != PrecompiledKind::Rand && m_ast.node(index).a != precompiled_none) {
+            spine.push_back(index);
+            index = m_ast.node(index).a;
+        }
+        flatten_head(index, chain);
+        for (size_t i = spine.size(); i-- > 0;) {
+            const PrecompiledNode& n = m_ast.node(spine[i]);
+            step(1);
+            chain.operators.push_back(n.kind);
+            flatten_operand(n.b, chain);
+        }
+    }
+
+    // Anything but a chain's left operand nests, so it counts toward the
+    // depth limit like eval does. The parser only puts chains there inside
+    // rand(), but a crafted image can nest them anywhere.
+    void flatten_operand(uint32_t index, Chain& chain) {
+        if (!is_chain(m_ast.node(index).kind)) {
+            chain.operands.push_back(eval(index));
+            return;
+        }
+        DepthGuard guard = descend();
+        flatten(index, chain);
+    }
+
+    void flatten_head(uint32_t index, Chain& chain) {
+        const PrecompiledNode& n = m_ast.node(index);
+        if (!is_chain(n.kind)) {
+            chain.operands.push_back(eval(index));
+            return;
+        }
+        step(1);
+        if (n.kind == PrecompiledKind::Rand) {
+            Chain span;
+            flatten_operand(n.b, span);
+            span.operators.push_back(PrecompiledKind::Minus);
+            flatten_operand(n.a, span);
+            span.operators.push_back(PrecompiledKind::Plus);
+            span.operands.push_back(1);
+            chain.operands.push_back(static_cast<int>(m_rng() % (uint32_t(RAND_MAX) + 1)));
+            chain.operators.push_back(PrecompiledKind::Mod);
+            chain.operands.push_back(reduce(std::move(span)));
+            chain.operators.push_back(PrecompiledKind::Plus);
+            flatten_operand(n.a, chain);
+            return;
+        }
+        chain.operands.push_back(0);
+        chain.operators.push_back(n.kind);
+        flatten_operand(n.b, chain);
+    }
+
+    // * / % bind tighter than + -, and both levels associate to the left.
+    static Value reduce(Chain chain) {
+        Value total;
+        Value term = std::move(chain.operands[0]);
+        std::optional<PrecompiledKind> pending;
+        for (size_t i = 0; i < chain.operators.size(); i++) {
+            PrecompiledKind op = chain.operators[i];
+            Value& next = chain.operands[i + 1];
+            if (op == PrecompiledKind::Plus || op == PrecompiledKind::Minus) {
+                total = pending ? arithmetic(pending.value(), std::move(total), std::move(term)) : std::move(term);
+                pending = op;
+                term = std::move(next);
+            }
+            else {
+                term = arithmetic(op, std::move(term), std::move(next));
+            }
+        }
+        return pending ? arithmetic(pending.value(), std::move(total), std::move(term)) : term;
+    }
+
+    const Value& literal(uint32_t index) {
+        if (!m_literals[index].has_value()) {
+            std::string text(m_ast.string(index));
+            char* end = nullptr;
+            if (text.find('.') != std::string::npos) {
+                double value = std::strtod(text.c_str(), &end);
+                if (*end != '\0') fail("malformed number " + text);
+                if (m_numeric != NumericBackend::Default) {
+                    m_literals[index] = with_backend([&](auto tag) -> Value { return linum::parse<decltype(tag)>(text.c_str()); });
+                }
+                else {
+                    m_literals[index] = value;
+                }
+            }
+            else {
+                long long value = std::strtoll(text.c_str(), &end, 10);
+                if (*end != '\0' || text.empty()) fail("malformed number " + text);
+                if (value > INT_MAX) fail("integer literal " + text + " is out of range");
+                m_literals[index] = static_cast<int>(value);
+            }
+        }
+        return m_literals[index].value();
+    }
+
+    // int arithmetic is done in 64 bits and wrapped, which is what the
+    // generated program does in practice; division traps as it would natively.
+    static int int_arithmetic(PrecompiledKind kind, int l, int r) {
+        int64_t result = 0;
+        switch (kind) {
+            case PrecompiledKind::Plus: result = int64_t(l) + r; break;
+            case PrecompiledKind::Minus: result = int64_t(l) - r; break;
+            case PrecompiledKind::Times: result = int64_t(l) * r; break;
+            case PrecompiledKind::Division:
+            case PrecompiledKind::Mod:
+                if (r == 0) fail("integer division by zero");
+                if (l == INT_MIN && r == -1) fail("integer overflow in division");
+                result = kind == PrecompiledKind::Division ? l / r : l % r;
+                break;
+            default: break;
+        }
+        return static_cast<int>(static_cast<uint32_t>(result));
+    }
+
+    static Value arithmetic(PrecompiledKind kind, Value left, Value right) {
+        return std::visit([kind](auto&& l, auto&& r) -> Value {
+            using L = std::decay_t<decltype(l)>;
+            using R = std::decay_t<decltype(r)>;
+            if constexpr (!std::is_same_v<L, R> && !std::is_same_v<L, int> && !std::is_same_v<R, int>
+                          && (is_backend_class_v<L> || is_backend_class_v<R>)) {
+                fail("mixed numeric types");
+            }
+            else if constexpr (is_array_v<L> || is_array_v<R>) {
+                switch (kind) {
+                    case PrecompiledKind::Plus: return std::move(l) + std::move(r);
+                    case PrecompiledKind::Minus: return std::move(l) - std::move(r);
+                    case PrecompiledKind::Times: return std::move(l) * std::move(r);
+                    case PrecompiledKind::Division: return std::move(l) / std::move(r);
+                    default: return std::move(l) % std::move(r);
+                }
+            }
+            else if constexpr (std::is_same_v<L, int> && std::is_same_v<R, int>) {
+                return int_arithmetic(kind, l, r);
+            }
+            else {
+                switch (kind) {
+                    case PrecompiledKind::Plus: return l + r;
+                    case PrecompiledKind::Minus: return l - r;
+                    case PrecompiledKind::Times: return l * r;
+                    case PrecompiledKind::Division: return l / r;
+                    default: fail("mod expects integer operands");
+                }
+            }
+        }, std::move(left), std::move(right));
+    }
+
+    MathTier resolve_tier(MathTier tier) const {
+        if (tier == MathTier::Default) tier = m_math_tier;
+        return tier == MathTier::Default ? MathTier::Exact : tier;
+    }
+
+    // Exact scalars keep the argument type, as the float overloads of std::sin
+    // and friends do; the tiered kernels work in double.
+    template <typename Exact>
+    Value unary_math(const PrecompiledNode& n, Exact exact, li::Array (*exact_n)(li::Array), double (*precise)(double), double (*fast)(double),
+                     li::Array (*precise_n)(const li::Array&), li::Array (*fast_n)(const li::Array&)) {
+        MathTier tier = resolve_tier(static_cast<MathTier>(n.tier));
+        return std::visit([&](auto&& x) -> Value {
+            if constexpr (is_array_v<decltype(x)>) {
+                if (tier == MathTier::Precise) return precise_n(x);
+                if (tier == MathTier::Fast) return fast_n(x);
+                return exact_n(std::move(x));
+            }
+            else if constexpr (is_backend_class_v<decltype(x)>) {
+                fail("numeric backend value in a native builtin");
+            }
+            else {
+                if (tier == MathTier::Precise) return precise(x);
+                if (tier == MathTier::Fast) return fast(x);
+                return exact(x);
+            }
+        }, eval(n.a));
+    }
+
+    Value pow(MathTier tier, Value base, Value exponent) {
+        if (backend_kernels(tier)) return backend_math([](auto k, auto b, auto e) { return k.pow(b, e); }, base, exponent);
+        tier = resolve_tier(tier);
+        return std::visit([tier](auto&& b, auto&& e) -> Value {
+            if constexpr (is_backend_class_v<decltype(b)> || is_backend_class_v<decltype(e)>) {
+                fail("numeric backend value in a native builtin");
+            }
+            else if constexpr (is_array_v<decltype(b)> || is_array_v<decltype(e)>) {
+                if (tier == MathTier::Precise) return li::pow_precise(b, e);
+                if (tier == MathTier::Fast) return li::pow_fast(b, e);
+                return li::pow(b, e);
+            }
+            else {
+                if (tier == MathTier::Precise) return limath::pow_precise(b, e);
+                if (tier == MathTier::Fast) return limath::pow_fast(b, e);
+                return std::pow(b, e);
+            }
+        }, std::move(base), std::move(exponent));
+    }
+
+    // Mirrors Generator::gen_log, including its folding of a constant base.
+    Value log(const PrecompiledNode& n) {
+        MathTier tier = resolve_tier(static_cast<MathTier>(n.tier));
+        std::optional<double> base = constant_value(n.a);
+        double ln_base = base.has_value() ? std::log(base.value()) : 0.0;
+        if (base.has_value() && std::isfinite(ln_base) && ln_base != 0.0) {
+            double scale = 1.0 / ln_base;
+            return std::visit([&](auto&& x) -> Value {
+                if constexpr (is_array_v<decltype(x)>) {
+                    if (tier == MathTier::Precise) return li::ln_precise(x) * scale;
+                    if (tier == MathTier::Fast) return li::ln_fast(x) * scale;
+                    return li::ln(std::move(x)) / ln_base;
+                }
+                else if constexpr (is_backend_class_v<decltype(x)>) {
+                    fail("numeric backend value in a native builtin");
+                }
+                else {
+                    if (tier == MathTier::Precise) return limath::ln_precise(x) * scale;
+                    if (tier == MathTier::Fast) return limath::ln_fast(x) * scale;
+                    return std::log(double(x)) / ln_base;
+                }
+            }, eval(n.b));
+        }
+        return std::visit([tier](auto&& b, auto&& x) -> Value {
+            if constexpr (is_backend_class_v<decltype(b)> || is_backend_class_v<decltype(x)>) {
+                fail("numeric backend value in a native builtin");
+            }
+            else if constexpr (is_array_v<decltype(b)> || is_array_v<decltype(x)>) {
+                if (tier == MathTier::Precise) return li::log_precise(b, x);
+                if (tier == MathTier::Fast) return li::log_fast(b, x);
+                return li::log(b, x);
+            }
+            else {
+                if (tier == MathTier::Precise) return limath::log_precise(b, x);
+                if (tier == MathTier::Fast) return limath::log_fast(b, x);
+                return std::log(double(x)) / std::log(double(b));
+            }
+        }, eval(n.a), eval(n.b));
+    }
+
+    std::optional<double> constant_value(uint32_t index) const {
+        while (m_ast.node(index).kind == PrecompiledKind::Grouped) index = m_ast.node(index).a;
+        const PrecompiledNode& n = m_ast.node(index);
+        if (n.kind == PrecompiledKind::IntLit) {
+            return std::strtod(std::string(m_ast.string(n.a)).c_str(), nullptr);
+        }
+        return {};
+    }
+
+    static double to_double(const Value& value, const char* context) {
+        if (std::holds_alternative<li::Array>(value)) fail(std::string(context) + " expects a scalar");
+        return std::visit([](const auto& v) -> double {
+            if constexpr (is_array_v<decltype(v)>) return 0.0;
+            else return static_cast<double>(v);
+        }, value);
+    }
+
+    // Out-of-range and NaN values become INT_MIN, as the x86 conversion the
+    // generated program compiles to does.
+    static int to_int(const Value& value) {
+        if (std::holds_alternative<li::Array>(value)) fail("int variable expects a scalar");
+        return std::visit([](const auto& v) -> int {
+            if constexpr (is_array_v<decltype(v)>) return 0;
+            else return linum::to_int(v);
+        }, value);
+    }
+
+    // Same predicate as Generator::backend_kernels: float64 only defers to
+    // the libm tiers when one other than exact is asked for.
+    bool backend_kernels(MathTier tier) const {
+        if (m_numeric == NumericBackend::Default) return false;
+        return m_numeric != NumericBackend::Float64 || resolve_tier(tier) == MathTier::Exact;
+    }
+
+    // Calls f with a value of the selected backend's type, for its type only.
+    template <typename F>
+    Value with_backend(F f) const {
+        switch (m_numeric) {
+            case NumericBackend::Float32: return f(float{});
+            case NumericBackend::LongDouble: return f(static_cast<long double>(0));
+            case NumericBackend::Fixed: return f(linum::Q16{});
+            case NumericBackend::DoubleDouble: return f(linum::dd{});
+            default: return f(double{});
+        }
+    }
+
+    int backend_digits() const {
+        return std::get<int>(with_backend([](auto tag) -> Value { return linum::digits<decltype(tag)>; }));
+    }
+
+    template <typename T>
+    static T to_backend(const Value& value, const char* context) {
+        return std::visit([context](const auto& v) -> T {
+            using V = std::decay_t<decltype(v)>;
+            if constexpr (is_array_v<V>) fail(std::string(context) + " expects a scalar");
+            else if constexpr (std::is_same_v<V, T>) return v;
+            else if constexpr (std::is_arithmetic_v<V>) return T(v);
+            else return T(static_cast<double>(v));
+        }, value);
+    }
+
+    // Runs a builtin through the selected backend's kernels with every
+    // operand converted to its type, as the generated linum:: calls do.
+    template <typename Kernel, typename... Args>
+    Value backend_math(Kernel kernel, const Args&... args) const {
+        return with_backend([&](auto tag) -> Value {
+            using T = decltype(tag);
+            return kernel(linum::Kernels<T>{}, to_backend<T>(args, "builtin")...);
+        });
+    }
+
+    static li::Array to_array(Value value, const char* context) {
+        if (!std::holds_alternative<li::Array>(value)) fail(std::string(context) + " expects an array");
+        return std::get<li::Array>(std::move(value));
+    }
+};
@@ -1,13 +1,27 @@
 #pragma once
+#include <cmath>
+#include <cstdlib>
 #include <optional>
 #include <string>
-#include <sstream>
 #include <unordered_map>
 #include "Parser.hpp"
+#include "Emitter.hpp"
+#include "Precompiled.hpp"
+#include "MathKernels.hpp"
+#include "ArrayRuntime.hpp"
+#include "NumericBackends.hpp"
 
 class Generator {
 public:
     Generator(Node node) : node(std::move(node)) {}
+    Generator(Node node, int fd) : node(std::move(node)), m_output(fd) {}
+    Generator(const PrecompiledAst& ast, int fd) : m_ast(&ast), m_output(fd) {}
+
+    // Tier for builtins that carry no tier of their own.
+    void set_math_tier(MathTier tier) { m_math_tier = tier; }
+
+    // Representation of float values; scalar programs only.
+    void set_numeric(NumericBackend backend) { m_numeric = backend; }
 
     void gen_stmt(const NodeStmt& node_stmt){
         struct StmtVisitor{
@@ -23,13 +37,24 @@ public:
                 generator->m_output << "\tint ";
                 generator->m_output << node_stmt_var.identifier.value.value();
                 generator->m_output << " = ";
+                generator->gen_int_open();
                 generator->gen_expr(node_stmt_var.expr);
+                generator->gen_int_close();
                 generator->m_output << ";\n";
 
                 generator->m_vars[node_stmt_var.identifier.value.value()] = Var{node_stmt_var.identifier.value.value()};
             }  
             void operator()(const NodeStmtVarFLOAT& node_stmt_var){
-                generator->m_output << "\tfloat ";
+                generator->m_output << "\t" << generator->float_type() << " ";
+                generator->m_output << node_stmt_var.identifier.value.value();
+                generator->m_output << " = ";
+                generator->gen_expr(node_stmt_var.expr);
+                generator->m_output << ";\n";
+
+                generator->m_vars[node_stmt_var.identifier.value.value()] = Var{node_stmt_var.identifier.value.value()};
+            }
+            void operator()(const NodeStmtVarARRAY& node_stmt_var){
+                generator->m_output << "\tli::Array ";
                 generator->m_output << node_stmt_var.identifier.value.value();
                 generator->m_output << " = ";
                 generator->gen_expr(node_stmt_var.expr);
@@ -39,7 +64,8 @@ public:
             }
 
             void operator()(const NodeStmtPow& node_stmt_pow){
-                generator->m_output << "\tstd::pow(";
+                generator->m_output << "\t";
+                generator->gen_math_open(node_stmt_pow.tier, "std::pow(", "pow", node_stmt_pow.base.is_array || node_stmt_pow.exponent.is_array);
                 generator->gen_expr(node_stmt_pow.base);
                 generator->m_output << ", ";
                 generator->gen_expr(node_stmt_pow.exponent);
@@ -50,31 +76,29 @@ public:
         std::visit(StmtVisitor{this}, node_stmt.node);
     }
 
+    // Chains are printed bottom up along their left spine, so chain length
+    // costs no stack; the visitor prints each link's operator and right side.
     void gen_expr(const NodeExpr& node_expr) {
         struct ExprVisitor {
             Generator* generator;
-            
+            bool is_array;
+
             void operator()(const NodeIntLit& node_int_lit) {
-                generator->m_output << node_int_lit.token.value.value();
+                generator->gen_literal(node_int_lit.token.value.value());
             }
 
             void operator()(const NodeBinaryExprPlus& node_binary_expr_plus) {
-                generator->gen_expr(*node_binary_expr_plus.left);
                 generator->m_output << "+";
                 generator->gen_expr(*node_binary_expr_plus.right);
             }
             void operator()(const NodeBinaryExprMinus& node_binary_expr_minus){
-                if (node_binary_expr_minus.left.has_value()) {
-                    generator->gen_expr(*node_binary_expr_minus.left.value());
-                }
-                else {
+                if (!node_binary_expr_minus.left.has_value()) {
                     generator->m_output << "0";
                 }
                 generator->m_output << "-";
                 generator->gen_expr(*node_binary_expr_minus.right);
             }
             void operator()(const NodeBinaryExprTimes& node_binary_expr_times){
-                generator->gen_expr(*node_binary_expr_times.left);
                 generator->m_output << "*";
                 generator->gen_expr(*node_binary_expr_times.right);
             }
@@ -84,7 +108,6 @@ public:
                 generator->m_output << ")";
             }
             void operator()(const NodeBinaryExprDivision& node_binary_expr_division){
-                generator->gen_expr(*node_binary_expr_division.left);
                 generator->m_output << "/";
                 generator->gen_expr(*node_binary_expr_division.right);
             }
@@ -92,52 +115,49 @@ public:
                 generator->m_output << node_expr_identifier.token.value.value();
             }
             void operator()(const NodeExprPow& node_expr_pow){
-                generator->m_output << "std::pow(";
+                generator->gen_math_open(node_expr_pow.tier, "std::pow(", "pow", is_array);
                 generator->gen_expr(*node_expr_pow.base);
                 generator->m_output << ", ";
                 generator->gen_expr(*node_expr_pow.exponent);
                 generator->m_output << ")";
             }
             void operator()(const NodeExprSqrt& node_expr_sqrt){
-                generator->m_output << "std::sqrt(";
+                generator->m_output << (is_array ? "li::sqrt(" : generator->backend_kernels(MathTier::Exact) ? "linum::sqrt<num>(" : "std::sqrt(");
                 generator->gen_expr(*node_expr_sqrt.base);
                 generator->m_output << ")";
             }
             void operator()(const NodeExprSin& node_expr_sin){
-                generator->m_output << "std::sin(";
+                generator->gen_math_open(node_expr_sin.tier, "std::sin(", "sin", is_array);
                 generator->gen_expr(*node_expr_sin.base);
                 generator->m_output << ")";
             }
             void operator()(const NodeExprCos& node_expr_cos){
-                generator->m_output << "std::cos(";
+                generator->gen_math_open(node_expr_cos.tier, "std::cos(", "cos", is_array);
                 generator->gen_expr(*node_expr_cos.base);
                 generator->m_output << ")";
             }
             void operator()(const NodeExprTan& node_expr_tan){
-                generator->m_output << "std::tan(";
+                generator->gen_math_open(node_expr_tan.tier, "std::tan(", "tan", is_array);
                 generator->gen_expr(*node_expr_tan.base);
                 generator->m_output << ")";
             }
             void operator()(const NodeExprLog& node_expr_log){
-                generator->m_output << "customlog(";
-                generator->gen_expr(*node_expr_log.base);
-                generator->m_output << ", ";
-                generator->gen_expr(*node_expr_log.exponent);
-                generator->m_output << ")";
+                generator->gen_log(node_expr_log.tier, is_array, constant_value(*node_expr_log.base),
+                                   [&] { generator->gen_expr(*node_expr_log.base); },
+                                   [&] { generator->gen_expr(*node_expr_log.exponent); });
             }
             void operator()(const NodeExprLn& node_expr_ln){
-                generator->m_output << "std::log(";
+                generator->gen_math_open(node_expr_ln.tier, "std::log(", "ln", is_array);
                 generator->gen_expr(*node_expr_ln.base);
                 generator->m_output << ")";
             }
             void operator()(const NodeBinaryExprMod& node_expr_ln){
-                generator->gen_expr(*node_expr_ln.left);
                 generator->m_output << " % ";
                 generator->gen_expr(*node_expr_ln.right);
                 
             }
             void operator()(const NodeExprAbs& node_expr_ln){
-                generator->m_output << " std::abs(";
+                generator->m_output << (is_array ? "li::abs(" : generator->backend_kernels(MathTier::Exact) ? "linum::abs(" : " std::abs(");
                 generator->gen_expr(*node_expr_ln.base);
                 generator->m_output << ")";
             }
@@ -150,32 +170,386 @@ public:
                 generator->m_output << ")+";
                 generator->gen_expr(*node_expr_ln.base);
             }
+            void operator()(const NodeExprLinspace& node_expr_linspace){
+                generator->m_output << "li::linspace(";
+                generator->gen_expr(*node_expr_linspace.start);
+                generator->m_output << ", ";
+                generator->gen_expr(*node_expr_linspace.stop);
+                generator->m_output << ", ";
+                generator->gen_expr(*node_expr_linspace.count);
+                generator->m_output << ")";
+            }
+            void operator()(const NodeExprRange& node_expr_range){
+                generator->m_output << "li::range(";
+                generator->gen_expr(*node_expr_range.start);
+                generator->m_output << ", ";
+                generator->gen_expr(*node_expr_range.stop);
+                generator->m_output << ")";
+            }
+            void operator()(const NodeExprArray& node_expr_array){
+                generator->m_output << "li::array(";
+                for (size_t i = 0; i < node_expr_array.elements.size(); i++) {
+                    if (i) generator->m_output << ", ";
+                    generator->gen_expr(*node_expr_array.elements[i]);
+                }
+                generator->m_output << ")";
+            }
+            void operator()(const NodeExprSum& node_expr_sum){
+                generator->m_output << "li::sum(";
+                generator->gen_expr(*node_expr_sum.base);
+                generator->m_output << ")";
+            }
+            void operator()(const NodeExprMax& node_expr_max){
+                generator->m_output << "li::max(";
+                generator->gen_expr(*node_expr_max.base);
+                generator->m_output << ")";
+            }
+            void operator()(const NodeExprMin& node_expr_min){
+                generator->m_output << "li::min(";
+                generator->gen_expr(*node_expr_min.base);
+                generator->m_output << ")";
+            }
+            void operator()(const NodeExprDot& node_expr_dot){
+                generator->m_output << "li::dot(";
+                generator->gen_expr(*node_expr_dot.left);
+                generator->m_output << ", ";
+                generator->gen_expr(*node_expr_dot.right);
+                generator->m_output << ")";
+            }
         };
 
-        std::visit(ExprVisitor{this}, node_expr.node);
+        std::vector<const NodeExpr*> spine{&node_expr};
+        while (const NodeExpr* left = chain_left(*spine.back())) {
+            spine.push_back(left);
+        }
+        for (size_t i = spine.size(); i-- > 0;) {
+            std::visit(ExprVisitor{this, spine[i]->is_array}, spine[i]->node);
+        }
     }
 
-    std::string generate() {
-        m_output << "#include <iostream>" << std::endl;
-        m_output << "#include <cmath>" << std::endl;
-        m_output << "#include <ctime>" << std::endl;
+    void gen_stmt(const PrecompiledStmt& stmt) {
+        switch (stmt.kind) {
+            case PrecompiledStmtKind::Exit:
+                m_output << "\tstd::cout <<  ";
+                gen_expr(stmt.a);
+                m_output << " << std::endl;\n";
+                break;
+            case PrecompiledStmtKind::VarInt:
+            case PrecompiledStmtKind::VarFloat:
+            case PrecompiledStmtKind::VarArray:
+                m_output << "\t" << (stmt.kind == PrecompiledStmtKind::VarInt ? "int" : stmt.kind == PrecompiledStmtKind::VarFloat ? float_type() : "li::Array") << " ";
+                m_output << m_ast->string(stmt.name);
+                m_output << " = ";
+                if (stmt.kind == PrecompiledStmtKind::VarInt) gen_int_open();
+                gen_expr(stmt.a);
+                if (stmt.kind == PrecompiledStmtKind::VarInt) gen_int_close();
+                m_output << ";\n";
+
+                m_vars[std::string(m_ast->string(stmt.name))] = Var{std::string(m_ast->string(stmt.name))};
+                break;
+            case PrecompiledStmtKind::Pow:
+                m_output << "\t";
+                gen_math_open(static_cast<MathTier>(stmt.tier), "std::pow(", "pow", m_ast->is_array(stmt.a) || m_ast->is_array(stmt.b));
+                gen_expr(stmt.a);
+                m_output << ", ";
+                gen_expr(stmt.b);
+                m_output << ");\n";
+                break;
+        }
+    }
+
+    void gen_expr(uint32_t index) {
+        std::vector<uint32_t> spine{index};
+        while (is_chain_link(m_ast->node(spine.back()))) {
+            spine.push_back(m_ast->node(spine.back()).a);
+        }
+        for (size_t i = spine.size(); i-- > 0;) {
+            gen_node(spine[i]);
+        }
+    }
+
+    static bool is_chain_link(const PrecompiledNode& n) {
+        switch (n.kind) {
+            case PrecompiledKind::Plus: case PrecompiledKind::Times: case PrecompiledKind::Division: case PrecompiledKind::Mod:
+                return true;
+            case PrecompiledKind::Minus:
+                return n.a != precompiled_none;
+            default:
+                return false;
+        }
+    }
+
+    // Prints one node; a chain link only prints its operator and right
+    // operand, gen_expr having printed what it nests on.
+    void gen_node(uint32_t index) {
+        const PrecompiledNode& n = m_ast->node(index);
+        bool is_array = m_ast->is_array(index);
+        switch (n.kind) {
+            case PrecompiledKind::IntLit:
+                gen_literal(m_ast->string(n.a));
+                break;
+            case PrecompiledKind::Identifier:
+                m_output << m_ast->string(n.a);
+                break;
+            case PrecompiledKind::Plus: gen_link(n, "+"); break;
+            case PrecompiledKind::Minus:
+                if (n.a == precompiled_none) {
+                    m_output << "0";
+                }
+                m_output << "-";
+                gen_expr(n.b);
+                break;
+            case PrecompiledKind::Times: gen_link(n, "*"); break;
+            case PrecompiledKind::Division: gen_link(n, "/"); break;
+            case PrecompiledKind::Mod: gen_link(n, " % "); break;
+            case PrecompiledKind::Grouped: gen_call(n, "("); break;
+            case PrecompiledKind::Pow: gen_call(n, "std::pow(", "pow"); break;
+            case PrecompiledKind::Sqrt: gen_call(n, is_array ? "li::sqrt(" : backend_kernels(MathTier::Exact) ? "linum::sqrt<num>(" : "std::sqrt("); break;
+            case PrecompiledKind::Sin: gen_call(n, "std::sin(", "sin"); break;
+            case PrecompiledKind::Cos: gen_call(n, "std::cos(", "cos"); break;
+            case PrecompiledKind::Tan: gen_call(n, "std::tan(", "tan"); break;
+            case PrecompiledKind::Log:
+                gen_log(static_cast<MathTier>(n.tier), is_array, constant_value(n.a),
+                        [&] { gen_expr(n.a); },
+                        [&] { gen_expr(n.b); });
+                break;
+            case PrecompiledKind::Ln: gen_call(n, "std::log(", "ln"); break;
+            case PrecompiledKind::Abs: gen_call(n, is_array ? "li::abs(" : backend_kernels(MathTier::Exact) ? "linum::abs(" : " std::abs("); break;
+            case PrecompiledKind::Rand:
+                m_output << " std::rand()%(";
+                gen_expr(n.b);
+                m_output << "-";
+                gen_expr(n.a);
+                m_output << "+1";
+                m_output << ")+";
+                gen_expr(n.a);
+                break;
+            case PrecompiledKind::Linspace: gen_list(n, "li::linspace("); break;
+            case PrecompiledKind::Range: gen_call(n, "li::range("); break;
+            case PrecompiledKind::ArrayLit: gen_list(n, "li::array("); break;
+            case PrecompiledKind::Sum: gen_call(n, "li::sum("); break;
+            case PrecompiledKind::Max: gen_call(n, "li::max("); break;
+            case PrecompiledKind::Min: gen_call(n, "li::min("); break;
+            case PrecompiledKind::Dot: gen_call(n, "li::dot("); break;
+        }
+    }
+
+    bool emit() {
+        m_output << "#include <iostream>\n";
+        m_output << "#include <cmath>\n";
+        m_output << "#include <ctime>\n";
+        // The array runtime is built on the batch kernels, so it pulls them in
+        // too. The program itself is compiled without -O, which also turns off
+        // inlining; the pragma has to turn it back on or no kernel inlines its
+        // polynomial and no array loop inlines its element function.
+        bool uses_arrays = m_ast ? m_ast->uses_arrays() : node.uses_arrays;
+        bool uses_backend = m_numeric != NumericBackend::Default;
+        if (uses_backend) {
+            m_output << "#include <climits>\n";
+            m_output << "#include <cstdlib>\n";
+            m_output << "#include <iomanip>\n";
+            m_output << "#include <string>\n";
+            m_output << "#include <type_traits>\n";
+        }
+        if (m_math_tier == MathTier::Precise || m_math_tier == MathTier::Fast || uses_arrays || uses_backend || (m_ast ? m_ast->uses_math_tiers() : node.uses_math_tiers)) {
+            m_output << "#include <cstddef>\n";
+            m_output << "#include <cstdint>\n";
+            m_output << "#include <cstring>\n";
+            if (uses_arrays) {
+                m_output << "#include <stdexcept>\n";
+                m_output << "#include <string>\n";
+                m_output << "#include <type_traits>\n";
+                m_output << "#include <utility>\n";
+                m_output << "#include <vector>\n";
+            }
+            m_output << "#pragma GCC push_options\n";
+            m_output << "#pragma GCC optimize(\"O3\", \"inline\")\n";
+            m_output << math_kernels_source << "\n";
+            if (uses_arrays) {
+                m_output << array_runtime_source << "\n";
+            }
+            if (uses_backend) {
+                m_output << numeric_backends_source << "\n";
+            }
+            m_output << "#pragma GCC pop_options\n";
+        }
+        if (uses_backend) {
+            m_output << "using num = " << float_type() << ";\n\n";
+        }
 
-        m_output << "double customlog(double base, double x) {" << std::endl;
-        m_output << "\treturn std::log(x) / std::log(base);" << std::endl;
-        m_output << "}\n" << std::endl;
-        m_output << "int main() {" << std::endl;
-        m_output << "\tstd::srand(std::time(NULL));" << std::endl;
-        for (const auto& node_expr : node.node) {
-            gen_stmt(node_expr);
+        m_output << "double customlog(double base, double x) {\n";
+        m_output << "\treturn std::log(x) / std::log(base);\n";
+        m_output << "}\n\n";
+        m_output << "int main() {\n";
+        m_output << "\tstd::srand(std::time(NULL));\n";
+        if (uses_backend) {
+            m_output << "\tstd::cout << std::setprecision(linum::digits<num>);\n";
+        }
+        if (m_ast) {
+            for (uint32_t i = 0; i < m_ast->stmt_count(); i++) {
+                gen_stmt(m_ast->stmt(i));
+            }
+        }
+        else {
+            for (const auto& node_expr : node.node) {
+                gen_stmt(node_expr);
+            }
         }
 
-        m_output << "\n\treturn 0;\n}" << std::endl;
-        return m_output.str();
+        m_output << "\n\treturn 0;\n}\n";
+        return m_output.flush();
+    }
+
+    std::string generate() {
+        emit();
+        return m_output.take();
     }
 
 private:
     Node node;
-    std::stringstream m_output;
+    const PrecompiledAst* m_ast = nullptr;
+    MathTier m_math_tier = MathTier::Default;
+    NumericBackend m_numeric = NumericBackend::Default;
+    Emitter m_output;
+
+    const char* float_type() const {
+        return m_numeric == NumericBackend::Default ? "float" : numeric_spelling(m_numeric).type;
+    }
+
+    // Under a backend, decimal literals are spelled as num so no expression
+    // silently computes in double.
+    void gen_literal(std::string_view text) {
+        if (m_numeric == NumericBackend::Default || text.find('.') == std::string_view::npos) {
+            m_output << text;
+            return;
+        }
+        NumericSpelling spelling = numeric_spelling(m_numeric);
+        m_output << spelling.literal_open << text << spelling.literal_close;
+    }
+
+    void gen_int_open() {
+        if (m_numeric != NumericBackend::Default) m_output << "linum::to_int(";
+    }
+
+    void gen_int_close() {
+        if (m_numeric != NumericBackend::Default) m_output << ")";
+    }
+
+    // Scalar builtins go to the backend's kernels, except that float64 keeps
+    // the precise and fast tiers.
+    bool backend_kernels(MathTier tier) const {
+        if (m_numeric == NumericBackend::Default) return false;
+        return m_numeric != NumericBackend::Float64 || resolve_tier(tier) == MathTier::Exact;
+    }
+
+    void gen_link(const PrecompiledNode& n, const char* op) {
+        m_output << op;
+        gen_expr(n.b);
+    }
+
+    void gen_list(const PrecompiledNode& n, const char* open) {
+        m_output << open;
+        for (uint32_t i = 0; i < n.b; i++) {
+            if (i) m_output << ", ";
+            gen_expr(m_ast->operand(n.a + i));
+        }
+        m_output << ")";
+    }
+
+    void gen_call(const PrecompiledNode& n, const char* open, const char* kernel = nullptr) {
+        if (kernel) {
+            gen_math_open(static_cast<MathTier>(n.tier), open, kernel, n.flags & precompiled_node_array);
+        }
+        else {
+            m_output << open;
+        }
+        gen_expr(n.a);
+        if (n.b != precompiled_none) {
+            m_output << ", ";
+            gen_expr(n.b);
+        }
+        m_output << ")";
+    }
+
+    MathTier resolve_tier(MathTier tier) const {
+        if (tier == MathTier::Default) tier = m_math_tier;
+        return tier == MathTier::Default ? MathTier::Exact : tier;
+    }
+
+    // Array operands go to the element-wise li:: forms of the same kernels.
+    void gen_math_open(MathTier tier, const char* exact, const char* kernel, bool is_array = false) {
+        if (!is_array && backend_kernels(tier)) {
+            m_output << "linum::" << kernel << "<num>(";
+            return;
+        }
+        const char* ns = is_array ? "li::" : "limath::";
+        switch (resolve_tier(tier)) {
+            case MathTier::Precise: m_output << ns << kernel << "_precise("; break;
+            case MathTier::Fast: m_output << ns << kernel << "_fast("; break;
+            default:
+                if (is_array) m_output << ns << kernel << "(";
+                else m_output << exact;
+                break;
+        }
+    }
+
+    // A constant base is folded to ln(base) at compile time, leaving one
+    // logarithm per call instead of two. The exact form keeps customlog's
+    // double argument so float operands are not narrowed to std::log(float).
+    template <typename BaseFn, typename ValueFn>
+    void gen_log(MathTier tier, bool is_array, std::optional<double> base, BaseFn&& gen_base, ValueFn&& gen_value) {
+        MathTier resolved = resolve_tier(tier);
+        if (!is_array && backend_kernels(tier)) {
+            base.reset();
+            resolved = MathTier::Exact;
+        }
+        double ln_base = base.has_value() ? std::log(base.value()) : 0.0;
+        if (base.has_value() && std::isfinite(ln_base) && ln_base != 0.0) {
+            if (resolved == MathTier::Exact) {
+                m_output << (is_array ? "(li::ln(" : "(std::log(double(");
+                gen_value();
+                m_output << (is_array ? ") / " : ")) / ") << ln_base << ")";
+            }
+            else {
+                m_output << "(";
+                gen_math_open(resolved, "std::log(", "ln", is_array);
+                gen_value();
+                m_output << ") * " << 1.0 / ln_base << ")";
+            }
+            return;
+        }
+        switch (resolved) {
+            case MathTier::Precise: m_output << (is_array ? "li::log_precise(" : "limath::log_precise("); break;
+            case MathTier::Fast: m_output << (is_array ? "li::log_fast(" : "limath::log_fast("); break;
+            default: m_output << (is_array ? "li::log(" : backend_kernels(tier) ? "linum::log<num>(" : "customlog("); break;
+        }
+        gen_base();
+        m_output << ", ";
+        gen_value();
+        m_output << ")";
+    }
+
+    static std::optional<double> constant_value(const NodeExpr& node_expr) {
+        if (auto lit = std::get_if<NodeIntLit>(&node_expr.node)) {
+            return std::strtod(lit->token.value.value().c_str(), nullptr);
+        }
+        if (auto grouped = std::get_if<NodeGroupedExpr>(&node_expr.node)) {
+            return constant_value(*grouped->innerExpr);
+        }
+        return {};
+    }
+
+    std::optional<double> constant_value(uint32_t index) const {
+        const PrecompiledNode& n = m_ast->node(index);
+        if (n.kind == PrecompiledKind::IntLit) {
+            return std::strtod(std::string(m_ast->string(n.a)).c_str(), nullptr);
+        }
+        if (n.kind == PrecompiledKind::Grouped) {
+            return constant_value(n.a);
+        }
+        return {};
+    }
+
     struct Var
     {
         std::string name;
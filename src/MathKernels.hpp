@@ -0,0 +1,217 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Builtin math kernels in two tiers below libm:
+//
+//   precise  polynomial kernels within 4 ulp over the reduced range
+//   fast     shorter polynomials good to ~1e-7 relative error
+//
+// A single precise kernel stays under 3 ulp. The bound is 4 because tan and
+// log are quotients of two rounded results: tan is sin/cos and log is ln/ln.
+// Even log(x) / log(b) with libm's log reaches 2 ulp.
+//
+// Scalar ln uses libm in both tiers. One value at a time, glibc's log is
+// faster than either kernel. Only the batch forms, which vectorize, use
+// ln_kernel.
+//
+// Both hand anything outside their reduced range (huge arguments, zero or
+// negative logarithms, non-finite values, overflowing exponents) back to libm,
+// so they differ from std:: only in accuracy. pow_precise is std::pow: a
+// ~1 ulp pow needs extended intermediate precision and glibc's is already
+// fast.
+//
+// The *_n batch forms evaluate the kernel on the whole array with no branches
+// so the loops auto-vectorize, then patch out-of-range lanes in a second pass.
+//
+// The generator emits this same source into programs that use non-exact
+// tiers, hence the macro: the code is compiled here and kept as text.
+#define LI_MATH_KERNELS(...) __VA_ARGS__ inline constexpr const char* math_kernels_source = #__VA_ARGS__;
+
+LI_MATH_KERNELS(
+namespace limath {
+
+constexpr double round_magic = 0x1.8p52;
+constexpr double two_over_pi = 0x1.45f306dc9c883p-1;
+constexpr double pio2_1 = 0x1.921fb544p0;
+constexpr double pio2_2 = 0x1.0b4611a6p-34;
+constexpr double pio2_3 = 0x1.3198a2e037073p-69;
+constexpr double ln2_hi = 0x1.62e42ffp-1;
+constexpr double ln2_lo = -0x1.718432a1b0e26p-35;
+constexpr double log2e = 0x1.71547652b82fep0;
+constexpr double sqrt2 = 0x1.6a09e667f3bcdp0;
+constexpr double trig_limit = 1e6;
+constexpr double exp_limit = 708.0;
+
+inline uint64_t to_bits(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+inline double from_bits(uint64_t bits) {
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// x = k * pi/2 + r with |r| <= pi/4. The first two parts of pi/2 carry 33 bits
+// so k * part is exact for |k| < 2^20.
+inline double reduce_pio2(double x, uint64_t& quadrant) {
+    double t = x * two_over_pi + round_magic;
+    double k = t - round_magic;
+    quadrant = to_bits(t) & 3;
+    return ((x - k * pio2_1) - k * pio2_2) - k * pio2_3;
+}
+
+template <bool Fast>
+inline double sin_poly(double r) {
+    double r2 = r * r;
+    if (Fast) {
+        return r + r * r2 * (-1.6666666666666666e-01 + r2 * (8.3333333333333332e-03 + r2 * (-1.9841269841269841e-04
+                   + r2 * 2.7557319223985893e-06)));
+    }
+    return r + r * r2 * (-1.6666666666666666e-01 + r2 * (8.3333333333333332e-03 + r2 * (-1.9841269841269841e-04
+               + r2 * (2.7557319223985893e-06 + r2 * (-2.5052108385441720e-08 + r2 * (1.6059043836821613e-10
+               + r2 * (-7.6471637318198164e-13 + r2 * 2.8114572543455206e-15)))))));
+}
+
+template <bool Fast>
+inline double cos_poly(double r) {
+    double r2 = r * r;
+    if (Fast) {
+        return 1.0 + r2 * (-0.5 + r2 * (4.1666666666666664e-02 + r2 * (-1.3888888888888889e-03
+                   + r2 * 2.4801587301587302e-05)));
+    }
+    return 1.0 + r2 * (-0.5 + r2 * (4.1666666666666664e-02 + r2 * (-1.3888888888888889e-03 + r2 * (2.4801587301587302e-05
+               + r2 * (-2.7557319223985888e-07 + r2 * (2.0876756987868100e-09 + r2 * (-1.1470745597729725e-11
+               + r2 * (4.7794773323873853e-14 + r2 * -1.5619206968586225e-16))))))));
+}
+
+// ln(m) for m in [sqrt(1/2), sqrt(2)) via 2 atanh((m - 1) / (m + 1)).
+template <bool Fast>
+inline double ln_poly(double m) {
+    double f = (m - 1.0) / (m + 1.0);
+    double f2 = f * f;
+    if (Fast) {
+        return 2.0 * f * (1.0 + f2 * (3.3333333333333331e-01 + f2 * (2.0000000000000001e-01 + f2 * (1.4285714285714285e-01
+                   + f2 * 1.1111111111111110e-01))));
+    }
+    return 2.0 * f * (1.0 + f2 * (3.3333333333333331e-01 + f2 * (2.0000000000000001e-01 + f2 * (1.4285714285714285e-01
+               + f2 * (1.1111111111111110e-01 + f2 * (9.0909090909090912e-02 + f2 * (7.6923076923076927e-02
+               + f2 * (6.6666666666666666e-02 + f2 * (5.8823529411764705e-02 + f2 * (5.2631578947368418e-02
+               + f2 * 4.7619047619047616e-02))))))))));
+}
+
+template <bool Fast>
+inline double exp_poly(double r) {
+    if (Fast) {
+        return 1.0 + r * (1.0 + r * (0.5 + r * (1.6666666666666666e-01 + r * (4.1666666666666664e-02
+                   + r * (8.3333333333333332e-03 + r * 1.3888888888888889e-03)))));
+    }
+    return 1.0 + r * (1.0 + r * (0.5 + r * (1.6666666666666666e-01 + r * (4.1666666666666664e-02 + r * (8.3333333333333332e-03
+               + r * (1.3888888888888889e-03 + r * (1.9841269841269841e-04 + r * (2.4801587301587302e-05
+               + r * (2.7557319223985893e-06 + r * (2.7557319223985888e-07 + r * (2.5052108385441720e-08
+               + r * (2.0876756987868100e-09 + r * 1.6059043836821613e-10))))))))))));
+}
+
+inline bool trig_in_range(double x) { return std::fabs(x) <= trig_limit; }
+inline bool ln_in_range(double x) { return x >= 0x1p-1022 && x <= 0x1.fffffffffffffp1023; }
+inline bool exp_in_range(double x) { return std::fabs(x) <= exp_limit; }
+
+template <bool Fast>
+inline double sin_kernel(double x) {
+    uint64_t q;
+    double r = reduce_pio2(x, q);
+    double s = sin_poly<Fast>(r);
+    double c = cos_poly<Fast>(r);
+    double v = (q & 1) ? c : s;
+    return (q & 2) ? -v : v;
+}
+
+template <bool Fast>
+inline double cos_kernel(double x) {
+    uint64_t q;
+    double r = reduce_pio2(x, q);
+    double s = sin_poly<Fast>(r);
+    double c = cos_poly<Fast>(r);
+    double v = (q & 1) ? s : c;
+    return ((q + 1) & 2) ? -v : v;
+}
+
+template <bool Fast>
+inline double tan_kernel(double x) {
+    uint64_t q;
+    double r = reduce_pio2(x, q);
+    double s = sin_poly<Fast>(r);
+    double c = cos_poly<Fast>(r);
+    return (q & 1) ? -c / s : s / c;
+}
+
+// Expects a positive normal x.
+template <bool Fast>
+inline double ln_kernel(double x) {
+    uint64_t bits = to_bits(x);
+    double m = from_bits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+    double e = from_bits(0x4330000000000000ULL | (bits >> 52)) - (0x1p52 + 1023.0);
+    bool high = m > sqrt2;
+    m = high ? m * 0.5 : m;
+    e = high ? e + 1.0 : e;
+    return e * ln2_hi + (e * ln2_lo + ln_poly<Fast>(m));
+}
+
+// Expects |x| <= exp_limit.
+template <bool Fast>
+inline double exp_kernel(double x) {
+    double t = x * log2e + round_magic;
+    double k = t - round_magic;
+    double r = (x - k * ln2_hi) - k * ln2_lo;
+    return exp_poly<Fast>(r) * from_bits((to_bits(t) + 1023) << 52);
+}
+
+inline double sin_precise(double x) { return trig_in_range(x) ? sin_kernel<false>(x) : std::sin(x); }
+inline double sin_fast(double x) { return trig_in_range(x) ? sin_kernel<true>(x) : std::sin(x); }
+inline double cos_precise(double x) { return trig_in_range(x) ? cos_kernel<false>(x) : std::cos(x); }
+inline double cos_fast(double x) { return trig_in_range(x) ? cos_kernel<true>(x) : std::cos(x); }
+inline double tan_precise(double x) { return trig_in_range(x) ? tan_kernel<false>(x) : std::tan(x); }
+inline double tan_fast(double x) { return trig_in_range(x) ? tan_kernel<true>(x) : std::tan(x); }
+inline double ln_precise(double x) { return std::log(x); }
+inline double ln_fast(double x) { return std::log(x); }
+inline double exp_precise(double x) { return exp_in_range(x) ? exp_kernel<false>(x) : std::exp(x); }
+inline double exp_fast(double x) { return exp_in_range(x) ? exp_kernel<true>(x) : std::exp(x); }
+inline double log_precise(double base, double x) { return ln_precise(x) / ln_precise(base); }
+inline double log_fast(double base, double x) { return ln_fast(x) / ln_fast(base); }
+inline double pow_precise(double x, double y) { return std::pow(x, y); }
+
+inline double pow_fast(double x, double y) {
+    if (ln_in_range(x) && std::isfinite(y)) {
+        double l = y * ln_kernel<true>(x);
+        if (exp_in_range(l)) return exp_kernel<true>(l);
+    }
+    return std::pow(x, y);
+}
+
+template <typename Kernel, typename Fallback>
+inline void map_n(const double* __restrict in, double* __restrict out, size_t n, bool (*in_range)(double), Kernel kernel, Fallback fallback) {
+    for (size_t i = 0; i < n; i++) {
+        double x = in[i];
+        out[i] = kernel(in_range(x) ? x : 1.0);
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!in_range(in[i])) out[i] = fallback(in[i]);
+    }
+}
+
+inline void sin_precise_n(const double* in, double* out, size_t n) { map_n(in, out, n, trig_in_range, sin_kernel<false>, [](double x) { return std::sin(x); }); }
+inline void sin_fast_n(const double* in, double* out, size_t n) { map_n(in, out, n, trig_in_range, sin_kernel<true>, [](double x) { return std::sin(x); }); }
+inline void cos_precise_n(const double* in, double* out, size_t n) { map_n(in, out, n, trig_in_range, cos_kernel<false>, [](double x) { return std::cos(x); }); }
+inline void cos_fast_n(const double* in, double* out, size_t n) { map_n(in, out, n, trig_in_range, cos_kernel<true>, [](double x) { return std::cos(x); }); }
+inline void tan_precise_n(const double* in, double* out, size_t n) { map_n(in, out, n, trig_in_range, tan_kernel<false>, [](double x) { return std::tan(x); }); }
+inline void tan_fast_n(const double* in, double* out, size_t n) { map_n(in, out, n, trig_in_range, tan_kernel<true>, [](double x) { return std::tan(x); }); }
+inline void ln_precise_n(const double* in, double* out, size_t n) { map_n(in, out, n, ln_in_range, ln_kernel<false>, [](double x) { return std::log(x); }); }
+inline void ln_fast_n(const double* in, double* out, size_t n) { map_n(in, out, n, ln_in_range, ln_kernel<true>, [](double x) { return std::log(x); }); }
+
+}
+)
@@ -0,0 +1,526 @@
+#pragma once
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// Numeric backends for `float` values. The default keeps the historical
+// mapping (float variables, double literals, libm); the others make every
+// non-int scalar one representation:
+//
+//   float32        float, float libm overloads
+//   float64        double, double libm (and the precise/fast tiers)
+//   long-double    long double, long double libm overloads
+//   q16.16         32-bit Q16.16 fixed point, integer-only kernels, saturating
+//   double-double  unevaluated sum of two doubles, ~106-bit significand
+//
+// Math tiers only apply to float64; the other backends always use their own
+// kernels. float[] values stay double under every backend.
+enum class NumericBackend {
+    Default,
+    Float32,
+    Float64,
+    LongDouble,
+    Fixed,
+    DoubleDouble
+};
+
+inline std::optional<NumericBackend> parse_numeric_backend(const std::string& name) {
+    if (name == "float32") return NumericBackend::Float32;
+    if (name == "float64") return NumericBackend::Float64;
+    if (name == "long-double") return NumericBackend::LongDouble;
+    if (name == "q16.16") return NumericBackend::Fixed;
+    if (name == "double-double") return NumericBackend::DoubleDouble;
+    return {};
+}
+
+// How generated code spells a backend's type and its decimal literals.
+struct NumericSpelling
+{
+    const char* type;
+    const char* literal_open;
+    const char* literal_close;
+};
+
+inline NumericSpelling numeric_spelling(NumericBackend backend) {
+    switch (backend) {
+        case NumericBackend::Float32: return {"float", "", "f"};
+        case NumericBackend::LongDouble: return {"long double", "", "L"};
+        case NumericBackend::Fixed: return {"linum::Q16", "linum::Q16(", ")"};
+        case NumericBackend::DoubleDouble: return {"linum::dd", "linum::dd(\"", "\")"};
+        default: return {"double", "", ""};
+    }
+}
+
+// As with the math kernels, the backends are compiled here for the evaluator
+// and emitted as text into programs that select one.
+#define LI_NUMERIC_BACKENDS(...) __VA_ARGS__ inline constexpr const char* numeric_backends_source = #__VA_ARGS__;
+
+LI_NUMERIC_BACKENDS(
+namespace linum {
+
+inline int32_t saturate(int64_t raw) {
+    return raw > INT32_MAX ? INT32_MAX : raw < INT32_MIN ? INT32_MIN : static_cast<int32_t>(raw);
+}
+
+struct Q16
+{
+    int32_t raw = 0;
+
+    Q16() = default;
+    Q16(int i) : raw(saturate(int64_t(i) * 65536)) {}
+    Q16(double d) : raw(d != d ? 0 : std::fabs(d) >= 32768.0 ? (d > 0 ? INT32_MAX : INT32_MIN) : saturate(std::llround(d * 65536.0))) {}
+    Q16(float f) : Q16(double(f)) {}
+    Q16(long double d) : Q16(double(d)) {}
+
+    static Q16 from_raw(int64_t raw) {
+        Q16 q;
+        q.raw = saturate(raw);
+        return q;
+    }
+
+    explicit operator double() const { return raw / 65536.0; }
+    int to_int() const { return raw / 65536; }
+
+    friend Q16 operator+(Q16 a, Q16 b) { return from_raw(int64_t(a.raw) + b.raw); }
+    friend Q16 operator-(Q16 a, Q16 b) { return from_raw(int64_t(a.raw) - b.raw); }
+    friend Q16 operator*(Q16 a, Q16 b) { return from_raw((int64_t(a.raw) * b.raw + 32768) >> 16); }
+    friend Q16 operator/(Q16 a, Q16 b) {
+        if (b.raw == 0) return from_raw(a.raw >= 0 ? INT32_MAX : INT32_MIN);
+        return from_raw(int64_t(a.raw) * 65536 / b.raw);
+    }
+    friend std::ostream& operator<<(std::ostream& out, Q16 q) { return out << double(q); }
+};
+
+// Double-double arithmetic after Dekker and Bailey: the value is hi + lo with
+// |lo| <= ulp(hi) / 2. Products are split by hand rather than with fma so the
+// result does not depend on the target having one.
+struct dd
+{
+    double hi = 0;
+    double lo = 0;
+
+    dd() = default;
+    dd(int i) : hi(i) {}
+    dd(float f) : hi(f) {}
+    dd(double d) : hi(d) {}
+    dd(long double d) : hi(double(d)), lo(double(d - (long double)(double(d)))) {}
+    dd(double h, double l) : hi(h), lo(l) {}
+
+    // Parses a decimal literal such as 0.1 to full double-double precision.
+    explicit dd(const char* text);
+
+    explicit operator double() const { return hi; }
+
+    int to_int() const {
+        double t = std::trunc(hi);
+        if (t == hi) {
+            if (hi > 0 && lo < 0) t -= 1;
+            else if (hi < 0 && lo > 0) t += 1;
+        }
+        if (!(t > double(INT_MIN) - 1.0 && t < double(INT_MAX) + 1.0)) return INT_MIN;
+        return static_cast<int>(t);
+    }
+
+    static dd quick_two_sum(double a, double b) {
+        double s = a + b;
+        if (!std::isfinite(s)) return dd(s, 0.0);
+        return dd(s, b - (s - a));
+    }
+
+    static dd two_sum(double a, double b) {
+        double s = a + b;
+        if (!std::isfinite(s)) return dd(s, 0.0);
+        double v = s - a;
+        return dd(s, (a - (s - v)) + (b - v));
+    }
+
+    static void split(double a, double& hi, double& lo) {
+        double t = 134217729.0 * a;
+        hi = t - (t - a);
+        lo = a - hi;
+    }
+
+    static dd two_prod(double a, double b) {
+        double p = a * b;
+        if (!std::isfinite(p)) return dd(p, 0.0);
+        double ah, al, bh, bl;
+        split(a, ah, al);
+        split(b, bh, bl);
+        return dd(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+    }
+
+    friend dd operator+(dd a, dd b) {
+        dd s = two_sum(a.hi, b.hi);
+        dd t = two_sum(a.lo, b.lo);
+        s = quick_two_sum(s.hi, s.lo + t.hi);
+        return quick_two_sum(s.hi, s.lo + t.lo);
+    }
+
+    friend dd operator-(dd a, dd b) { return a + dd(-b.hi, -b.lo); }
+
+    friend dd operator*(dd a, dd b) {
+        dd p = two_prod(a.hi, b.hi);
+        return quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+    }
+
+    friend dd operator/(dd a, dd b) {
+        double q1 = a.hi / b.hi;
+        if (!std::isfinite(q1) || b.hi == 0) return dd(q1, 0.0);
+        dd r = a - b * dd(q1);
+        double q2 = r.hi / b.hi;
+        r = r - b * dd(q2);
+        double q3 = r.hi / b.hi;
+        return quick_two_sum(q1, q2) + dd(q3);
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, dd x);
+};
+
+inline dd pow10(int e) {
+    dd p(1.0);
+    for (int i = 0; i < (e < 0 ? -e : e); i++) p = p * dd(10.0);
+    return e < 0 ? dd(1.0) / p : p;
+}
+
+inline dd::dd(const char* text) {
+    dd value;
+    int fraction = -1;
+    for (const char* c = text; *c; c++) {
+        if (*c == '.') fraction = 0;
+        else {
+            value = value * dd(10.0) + dd(*c - '0');
+            if (fraction >= 0) fraction++;
+        }
+    }
+    *this = fraction > 0 ? value / pow10(fraction) : value;
+}
+
+// Prints like the default float format, %g at the stream's precision, with
+// the digits taken from both halves once the precision exceeds a double's.
+inline std::ostream& operator<<(std::ostream& out, dd x) {
+    int precision = static_cast<int>(out.precision());
+    if (precision <= 17 || !std::isfinite(x.hi) || x.hi == 0) return out << x.hi;
+    std::string text = x.hi < 0 ? "-" : "";
+    if (x.hi < 0) x = dd(-x.hi, -x.lo);
+    int e = static_cast<int>(std::floor(std::log10(x.hi)));
+    dd y = x / pow10(e);
+    if (y.hi < 1) { y = y * dd(10.0); e--; }
+    if (y.hi >= 10) { y = y / dd(10.0); e++; }
+
+    std::string digits;
+    for (int i = 0; i <= precision; i++) {
+        int d = static_cast<int>(std::floor(y.hi));
+        d = d < 0 ? 0 : d > 9 ? 9 : d;
+        digits.push_back(static_cast<char>('0' + d));
+        y = (y - dd(d)) * dd(10.0);
+    }
+    bool carry = digits[precision] >= '5';
+    digits.pop_back();
+    for (int i = precision - 1; carry && i >= 0; i--) {
+        carry = digits[i] == '9';
+        digits[i] = carry ? '0' : static_cast<char>(digits[i] + 1);
+    }
+    if (carry) {
+        digits.insert(digits.begin(), '1');
+        digits.pop_back();
+        e++;
+    }
+    while (digits.size() > 1 && digits.back() == '0') digits.pop_back();
+
+    if (e < -4 || e >= precision) {
+        text += digits.substr(0, 1);
+        if (digits.size() > 1) text += "." + digits.substr(1);
+        std::string exponent = std::to_string(e < 0 ? -e : e);
+        text += std::string(e < 0 ? "e-" : "e+") + (exponent.size() < 2 ? "0" : "") + exponent;
+    }
+    else if (e < 0) {
+        text += "0." + std::string(-e - 1, '0') + digits;
+    }
+    else {
+        if (digits.size() <= size_t(e) + 1) digits.append(e + 1 - digits.size(), '0');
+        text += digits.substr(0, e + 1);
+        if (digits.size() > size_t(e) + 1) text += "." + digits.substr(e + 1);
+    }
+    return out << text;
+}
+
+template <typename T>
+struct Kernels;
+
+// The native backends use the libm overload for their own type.
+template <typename T>
+struct NativeKernels
+{
+    static T sqrt(T x) { return std::sqrt(x); }
+    static T sin(T x) { return std::sin(x); }
+    static T cos(T x) { return std::cos(x); }
+    static T tan(T x) { return std::tan(x); }
+    static T ln(T x) { return std::log(x); }
+    static T log(T base, T x) { return std::log(x) / std::log(base); }
+    static T pow(T x, T y) { return std::pow(x, y); }
+    static T abs(T x) { return std::fabs(x); }
+};
+
+template <> struct Kernels<float> : NativeKernels<float> {};
+template <> struct Kernels<double> : NativeKernels<double> {};
+template <> struct Kernels<long double> : NativeKernels<long double> {};
+
+// Q16.16 kernels work on Q2.30 intermediates in 64-bit integers and never
+// touch floating point. Results that do not fit saturate; where a float would
+// give NaN (ln of a non-positive, non-integer power of a negative) they give
+// the saturated minimum or zero.
+template <>
+struct Kernels<Q16>
+{
+    static constexpr int64_t one = int64_t(1) << 30;
+    static constexpr int64_t pi = 3373259426;
+    static constexpr int64_t half_pi = 1686629713;
+    static constexpr int64_t two_pi = 6746518852;
+    static constexpr int64_t ln2 = 744261118;
+
+    static int64_t mul(int64_t a, int64_t b) { return (a * b) >> 30; }
+
+    static Q16 from_q30(int64_t x) { return Q16::from_raw((x + 8192) >> 14); }
+
+    // sin of a Q2.30 angle.
+    static int64_t sin30(int64_t x) {
+        int64_t r = x % two_pi;
+        if (r < 0) r += two_pi;
+        if (r > pi) r -= two_pi;
+        if (r > half_pi) r = pi - r;
+        if (r < -half_pi) r = -pi - r;
+        int64_t r2 = mul(r, r);
+        int64_t t = one;
+        t = one - mul(r2, t) / 110;
+        t = one - mul(r2, t) / 72;
+        t = one - mul(r2, t) / 42;
+        t = one - mul(r2, t) / 20;
+        t = one - mul(r2, t) / 6;
+        return mul(r, t);
+    }
+
+    // ln of a positive Q16.16 raw value, in Q2.30.
+    static int64_t ln30(int32_t raw) {
+        int n = 31 - __builtin_clz(static_cast<uint32_t>(raw));
+        int64_t m = int64_t(raw) << (30 - n);
+        int64_t f = ((m - one) << 30) / (m + one);
+        int64_t f2 = mul(f, f);
+        int64_t t = one / 13;
+        t = one / 11 + mul(f2, t);
+        t = one / 9 + mul(f2, t);
+        t = one / 7 + mul(f2, t);
+        t = one / 5 + mul(f2, t);
+        t = one / 3 + mul(f2, t);
+        t = one + mul(f2, t);
+        return (n - 16) * ln2 + 2 * mul(f, t);
+    }
+
+    // exp of a Q2.30 value, as Q16.16.
+    static Q16 exp30(int64_t x) {
+        if (x > 11 * one) return Q16::from_raw(INT32_MAX);
+        if (x < -12 * one) return Q16();
+        int64_t k = x / ln2 - (x % ln2 < 0 ? 1 : 0);
+        int64_t r = x - k * ln2;
+        int64_t t = one;
+        for (int i = 9; i >= 1; i--) t = one + mul(r, t) / i;
+        int shift = 14 - static_cast<int>(k);
+        if (shift <= 0) return Q16::from_raw(t << -shift);
+        return Q16::from_raw((t + (int64_t(1) << (shift - 1))) >> shift);
+    }
+
+    static Q16 sqrt(Q16 x) {
+        if (x.raw <= 0) return Q16();
+        uint64_t v = uint64_t(x.raw) << 16;
+        uint64_t root = 0;
+        for (uint64_t bit = uint64_t(1) << 62; bit; bit >>= 2) {
+            if (v >= root + bit) {
+                v -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else {
+                root >>= 1;
+            }
+        }
+        return Q16::from_raw(static_cast<int64_t>(root));
+    }
+
+    static Q16 sin(Q16 x) { return from_q30(sin30(int64_t(x.raw) << 14)); }
+    static Q16 cos(Q16 x) { return from_q30(sin30((int64_t(x.raw) << 14) + half_pi)); }
+
+    static Q16 tan(Q16 x) {
+        int64_t s = sin30(int64_t(x.raw) << 14);
+        int64_t c = sin30((int64_t(x.raw) << 14) + half_pi);
+        if (c == 0) return Q16::from_raw(s >= 0 ? INT32_MAX : INT32_MIN);
+        return Q16::from_raw(s * 65536 / c);
+    }
+
+    static Q16 ln(Q16 x) {
+        if (x.raw <= 0) return Q16::from_raw(INT32_MIN);
+        return from_q30(ln30(x.raw));
+    }
+
+    static Q16 log(Q16 base, Q16 x) {
+        if (x.raw <= 0 || base.raw <= 0) return Q16::from_raw(INT32_MIN);
+        int64_t b = ln30(base.raw);
+        if (b == 0) return Q16::from_raw(INT32_MAX);
+        return Q16::from_raw(ln30(x.raw) * 65536 / b);
+    }
+
+    // Small integer exponents multiply out exactly; the rest go through
+    // exp(y ln x).
+    static Q16 pow(Q16 x, Q16 y) {
+        if (y.raw % 65536 == 0 && y.raw >= -64 * 65536 && y.raw <= 64 * 65536) {
+            int n = y.raw / 65536;
+            Q16 result(1), base = x;
+            for (int e = n < 0 ? -n : n; e; e >>= 1) {
+                if (e & 1) result = result * base;
+                base = base * base;
+            }
+            return n < 0 ? Q16(1) / result : result;
+        }
+        if (x.raw <= 0) return Q16();
+        int64_t l = ln30(x.raw);
+        int64_t whole = y.raw >> 16;
+        int64_t fraction = y.raw & 0xffff;
+        return exp30(l * whole + ((l * fraction) >> 16));
+    }
+
+    static Q16 abs(Q16 x) { return Q16::from_raw(x.raw < 0 ? -int64_t(x.raw) : x.raw); }
+};
+
+// Double-double kernels reduce the argument and sum Taylor series in
+// double-double until the terms vanish; ln refines the double log with one
+// Newton step on exp.
+template <>
+struct Kernels<dd>
+{
+    static dd ln2() { return dd(6.93147180559945286e-01, 2.31904681384629956e-17); }
+    static dd half_pi() { return dd(1.57079632679489656e+00, 6.12323399573676604e-17); }
+
+    static dd sqrt(dd x) {
+        if (!(x.hi > 0) || !std::isfinite(x.hi)) return dd(std::sqrt(x.hi));
+        double y = std::sqrt(x.hi);
+        dd r = x - dd::two_prod(y, y);
+        return dd::quick_two_sum(y, r.hi / (2.0 * y));
+    }
+
+    static dd exp(dd x) {
+        if (x.hi > 709.7) return dd(INFINITY);
+        if (x.hi < -745.0) return dd();
+        if (x.hi != x.hi) return x;
+        double k = std::nearbyint(x.hi / ln2().hi);
+        dd r = x - ln2() * dd(k);
+        r = dd(std::ldexp(r.hi, -10), std::ldexp(r.lo, -10));
+        dd term = r, sum = r;
+        for (int i = 2; i < 20 && std::fabs(term.hi) > 1e-36; i++) {
+            term = term * r / dd(double(i));
+            sum = sum + term;
+        }
+        for (int i = 0; i < 10; i++) sum = sum * (sum + dd(2.0));
+        sum = sum + dd(1.0);
+        int e = static_cast<int>(k);
+        return dd(std::ldexp(sum.hi, e), std::ldexp(sum.lo, e));
+    }
+
+    static dd ln(dd x) {
+        if (!(x.hi > 0) || !std::isfinite(x.hi)) return dd(std::log(x.hi));
+        dd y(std::log(x.hi));
+        return y + x * exp(dd(-y.hi, -y.lo)) - dd(1.0);
+    }
+
+    // sin or cos of |r| <= pi/4 by its Taylor series.
+    static dd series(dd r, bool cosine) {
+        dd r2 = r * r;
+        dd term = cosine ? dd(1.0) : r;
+        dd sum = term;
+        for (int n = cosine ? 1 : 2; n < 40 && std::fabs(term.hi) > 1e-36; n += 2) {
+            term = term * r2 / dd(-double(n) * double(n + 1));
+            sum = sum + term;
+        }
+        return sum;
+    }
+
+    static dd sin_cos(dd x, bool cosine) {
+        if (!std::isfinite(x.hi)) return dd(NAN);
+        double k = std::nearbyint(x.hi / half_pi().hi);
+        dd r = x - half_pi() * dd(k);
+        int q = static_cast<int>(std::fmod(k, 4.0));
+        q = (q + (cosine ? 1 : 0) + 4) % 4;
+        dd v = series(r, q & 1);
+        return q & 2 ? dd(-v.hi, -v.lo) : v;
+    }
+
+    static dd sin(dd x) { return sin_cos(x, false); }
+    static dd cos(dd x) { return sin_cos(x, true); }
+    static dd tan(dd x) { return sin(x) / cos(x); }
+    static dd log(dd base, dd x) { return ln(x) / ln(base); }
+
+    static dd pow(dd x, dd y) {
+        if (y.lo == 0 && y.hi == std::trunc(y.hi) && std::fabs(y.hi) < 2147483648.0) {
+            long long n = static_cast<long long>(y.hi);
+            dd result(1.0), base = x;
+            for (long long e = n < 0 ? -n : n; e; e >>= 1) {
+                if (e & 1) result = result * base;
+                base = base * base;
+            }
+            return n < 0 ? dd(1.0) / result : result;
+        }
+        if (x.hi < 0) return dd(NAN);
+        if (x.hi == 0) return dd(y.hi > 0 ? 0.0 : INFINITY);
+        return exp(y * ln(x));
+    }
+
+    static dd abs(dd x) { return x.hi < 0 ? dd(-x.hi, -x.lo) : x; }
+};
+
+// Builtins as the generated program calls them: linum::sin<num>(x) converts
+// x (an int or num) to num and runs that backend's kernel.
+template <typename T, typename A> inline T sqrt(const A& x) { return Kernels<T>::sqrt(T(x)); }
+template <typename T, typename A> inline T sin(const A& x) { return Kernels<T>::sin(T(x)); }
+template <typename T, typename A> inline T cos(const A& x) { return Kernels<T>::cos(T(x)); }
+template <typename T, typename A> inline T tan(const A& x) { return Kernels<T>::tan(T(x)); }
+template <typename T, typename A> inline T ln(const A& x) { return Kernels<T>::ln(T(x)); }
+template <typename T, typename A, typename B> inline T log(const A& base, const B& x) { return Kernels<T>::log(T(base), T(x)); }
+template <typename T, typename A, typename B> inline T pow(const A& x, const B& y) { return Kernels<T>::pow(T(x), T(y)); }
+
+// abs keeps int as int, like std::abs.
+template <typename A>
+inline A abs(const A& x) {
+    if constexpr (std::is_integral_v<A>) return x < 0 ? static_cast<A>(0u - static_cast<unsigned>(x)) : x;
+    else return Kernels<A>::abs(x);
+}
+
+// Truncates toward zero; out-of-range values and NaN give INT_MIN, which is
+// what the x86 conversion does natively.
+template <typename A>
+inline int to_int(const A& x) {
+    if constexpr (std::is_integral_v<A>) return x;
+    else if constexpr (std::is_floating_point_v<A>) {
+        if (!(x > A(INT_MIN) - 1 && x < A(INT_MAX) + 1)) return INT_MIN;
+        return static_cast<int>(x);
+    }
+    else return x.to_int();
+}
+
+template <typename T>
+inline T parse(const char* text) {
+    if constexpr (std::is_same_v<T, float>) return std::strtof(text, nullptr);
+    else if constexpr (std::is_same_v<T, long double>) return std::strtold(text, nullptr);
+    else if constexpr (std::is_same_v<T, dd>) return dd(text);
+    else return T(std::strtod(text, nullptr));
+}
+
+// Significant digits `fin` prints, enough to round-trip each type.
+template <typename T> constexpr int digits = 17;
+template <> constexpr int digits<float> = 9;
+template <> constexpr int digits<long double> = 21;
+template <> constexpr int digits<Q16> = 10;
+template <> constexpr int digits<dd> = 32;
+
+}
+)
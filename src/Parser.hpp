@@ -3,8 +3,24 @@
 #include <optional>
 #include <string>
 #include "Tokenizer.hpp"
+#include "Diagnostic.hpp"
 #include <variant>
 #include <memory>
+#include <unordered_set>
+
+enum class MathTier {
+    Default,
+    Exact,
+    Precise,
+    Fast
+};
+
+inline std::optional<MathTier> parse_math_tier(const std::string& name) {
+    if (name == "exact") return MathTier::Exact;
+    if (name == "precise") return MathTier::Precise;
+    if (name == "fast") return MathTier::Fast;
+    return {};
+}
 
 struct NodeIntLit
 {
@@ -68,6 +84,7 @@ struct NodeExprIdentifier
 struct NodeExprPow{
     std::shared_ptr<NodeExpr> base;
     std::shared_ptr<NodeExpr> exponent;
+    MathTier tier = MathTier::Default;
 };
 
 struct NodeExprSqrt{
@@ -76,25 +93,30 @@ struct NodeExprSqrt{
 
 struct NodeExprSin{
     std::shared_ptr<NodeExpr> base;
+    MathTier tier = MathTier::Default;
 };
 
 struct NodeExprCos{
     std::shared_ptr<NodeExpr> base;
+    MathTier tier = MathTier::Default;
 };
 
 struct NodeExprTan{
     std::shared_ptr<NodeExpr> base;
+    MathTier tier = MathTier::Default;
 };
 
 struct NodeExprLog
 {
     std::shared_ptr<NodeExpr> base;
     std::shared_ptr<NodeExpr> exponent;
+    MathTier tier = MathTier::Default;
 };
 
 struct NodeExprLn
 {
     std::shared_ptr<NodeExpr> base;
+    MathTier tier = MathTier::Default;
 };
 
 struct NodeExprAbs{
@@ -106,7 +128,44 @@ struct NodeExprRand{
     std::shared_ptr<NodeExpr> exponent;
 };
 
+struct NodeExprLinspace{
+    std::shared_ptr<NodeExpr> start;
+    std::shared_ptr<NodeExpr> stop;
+    std::shared_ptr<NodeExpr> count;
+};
+
+struct NodeExprRange{
+    std::shared_ptr<NodeExpr> start;
+    std::shared_ptr<NodeExpr> stop;
+};
+
+struct NodeExprArray{
+    std::vector<std::shared_ptr<NodeExpr>> elements;
+};
+
+struct NodeExprSum{
+    std::shared_ptr<NodeExpr> base;
+};
 
+struct NodeExprMax{
+    std::shared_ptr<NodeExpr> base;
+};
+
+struct NodeExprMin{
+    std::shared_ptr<NodeExpr> base;
+};
+
+struct NodeExprDot{
+    std::shared_ptr<NodeExpr> left;
+    std::shared_ptr<NodeExpr> right;
+};
+
+
+// `is_array` is set when the expression evaluates to a float[]; scalar
+// operands of such an expression are broadcast across its elements.
+//
+// Operator chains nest on their left operand and have no length limit, so
+// anything that walks a chain follows that spine with a loop; see chain_left.
 struct NodeExpr
 {
     std::variant<NodeIntLit, NodeBinaryExprPlus, NodeBinaryExprMinus, 
@@ -114,10 +173,48 @@ struct NodeExpr
                 NodeExprIdentifier, NodeExprPow, NodeExprSqrt,
                 NodeExprSin, NodeExprCos, NodeExprTan,
                 NodeExprLog, NodeExprLn, NodeBinaryExprMod,
-                NodeExprAbs, NodeExprRand
+                NodeExprAbs, NodeExprRand, NodeExprLinspace,
+                NodeExprRange, NodeExprArray, NodeExprSum,
+                NodeExprMax, NodeExprMin, NodeExprDot
                 > node;    
+    bool is_array = false;
+
+    NodeExpr(const NodeExpr&) = default;
+    NodeExpr(NodeExpr&&) = default;
+    NodeExpr& operator=(const NodeExpr&) = default;
+    NodeExpr& operator=(NodeExpr&&) = default;
+
+    // Releases the spine one link at a time instead of recursing per operator.
+    ~NodeExpr() {
+        std::shared_ptr<NodeExpr> left = detach_left(*this);
+        while (left && left.use_count() == 1) {
+            std::shared_ptr<NodeExpr> next = detach_left(*left);
+            left = std::move(next);
+        }
+    }
+
+private:
+    static std::shared_ptr<NodeExpr> detach_left(NodeExpr& node_expr) {
+        if (auto plus = std::get_if<NodeBinaryExprPlus>(&node_expr.node)) return std::move(plus->left);
+        if (auto minus = std::get_if<NodeBinaryExprMinus>(&node_expr.node)) return minus->left.has_value() ? std::move(minus->left.value()) : nullptr;
+        if (auto times = std::get_if<NodeBinaryExprTimes>(&node_expr.node)) return std::move(times->left);
+        if (auto division = std::get_if<NodeBinaryExprDivision>(&node_expr.node)) return std::move(division->left);
+        if (auto mod = std::get_if<NodeBinaryExprMod>(&node_expr.node)) return std::move(mod->left);
+        return nullptr;
+    }
 };
 
+// The operand an operator chain link nests on, or null if node_expr is not a
+// link (a unary minus is where its chain starts).
+inline const NodeExpr* chain_left(const NodeExpr& node_expr) {
+    if (auto plus = std::get_if<NodeBinaryExprPlus>(&node_expr.node)) return plus->left.get();
+    if (auto minus = std::get_if<NodeBinaryExprMinus>(&node_expr.node)) return minus->left.has_value() ? minus->left.value().get() : nullptr;
+    if (auto times = std::get_if<NodeBinaryExprTimes>(&node_expr.node)) return times->left.get();
+    if (auto division = std::get_if<NodeBinaryExprDivision>(&node_expr.node)) return division->left.get();
+    if (auto mod = std::get_if<NodeBinaryExprMod>(&node_expr.node)) return mod->left.get();
+    return nullptr;
+}
+
 struct NodeStmtExit{
     NodeExpr expr;
 };
@@ -132,20 +229,28 @@ struct NodeStmtVarFLOAT{
     NodeExpr expr;
 };
 
+struct NodeStmtVarARRAY{
+    Token identifier;
+    NodeExpr expr;
+};
+
 
 struct NodeStmtPow {
     NodeExpr base;
     NodeExpr exponent;
+    MathTier tier = MathTier::Default;
 };
 
 
 struct NodeStmt{
-    std::variant<NodeStmtExit, NodeStmtVarINT, NodeStmtPow, NodeStmtVarFLOAT> node;
+    std::variant<NodeStmtExit, NodeStmtVarINT, NodeStmtPow, NodeStmtVarFLOAT, NodeStmtVarARRAY> node;
 };
 
 struct Node
 {
     std::vector<NodeStmt> node;
+    bool uses_math_tiers = false;
+    bool uses_arrays = false;
 };
 
 
@@ -153,197 +258,261 @@ class Parser {
     public:
         Parser(std::vector<Token> tokens) : tokens(move(tokens)) {};
 
+        // Parses the whole file. A bad statement is reported and skipped up to
+        // the next statement keyword, so one pass reports every problem; the
+        // Node is only returned when there were none.
         std::optional<Node> parse() {
             Node node;
             while (peak().has_value())
             {
-                if (auto expr = parseStatement()) {
+                int start = index;
+                size_t errors = m_diagnostics.size();
+                bool parsed = false;
+                if (peak().value().type == TokenType::MATH) {
+                    parsed = parseMathDirective();
+                }
+                else if (auto expr = parseStatement()) {
                     node.node.push_back(expr.value());
+                    parsed = true;
                 }
-                else {
-                    exit(EXIT_FAILURE);
+                if (!parsed) {
+                    if (m_diagnostics.size() == errors) {
+                        error("invalid statement");
+                    }
+                    synchronize(start);
                 }
             }
 
+            node.uses_math_tiers = m_uses_math_tiers;
+            node.uses_arrays = m_uses_arrays;
+            if (!m_diagnostics.empty()) return {};
             return node;
         };
 
+        const std::vector<Diagnostic>& diagnostics() const { return m_diagnostics; }
+
+        // `math <tier>` sets the tier for every builtin parsed after it.
+        bool parseMathDirective() {
+            consume();
+            if (!peakIs(TokenType::IDENTIFIER)) {
+                error("expected a math tier (exact, precise or fast)");
+                return false;
+            }
+            Token name = consume();
+            auto tier = parse_math_tier(name.value.value());
+            if (!tier) {
+                error(name, "unknown math tier '" + name.value.value() + "', expected exact, precise or fast");
+                return false;
+            }
+            m_math_tier = tier.value();
+            return true;
+        }
+
+
+        // Later passes recurse into nested expressions, so nesting is capped
+        // here rather than letting input like pow(pow(pow(... exhaust the
+        // stack. Operator chains do not count: passes walk them with a loop.
+        static constexpr int max_expression_depth = 1000;
 
         std::optional<NodeExpr> parseExpression() {
+            if (m_depth >= max_expression_depth) {
+                return tooDeep();
+            }
+            int depth = m_depth++;
+            auto node_expr = parseNestedExpression();
+            m_depth = depth;
+            return node_expr;
+        }
+
+        std::optional<NodeExpr> parseNestedExpression() {
             std::optional<NodeExpr> node_expr;
 
-            if (peak().has_value() && peak().value().type == TokenType::POW && peak(1).value().type == TokenType::OPENPAREN) {
-                consume();
+            if (peakIs(TokenType::POW) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
                 consume();
+                auto tier = tierOf(name);
+                if (!tier) return {};
                 auto base = parseExpression();
-                if (!base) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::COMMA)) {
-                    return {};
-                }
-                consume();
-
+                if (!base || !expect(TokenType::COMMA, "','")) return {};
                 auto exponent = parseExpression();
-                if (!exponent) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
-                consume();
-                node_expr = NodeExpr{ NodeExprPow{std::make_shared<NodeExpr>(base.value()), std::make_shared<NodeExpr>(exponent.value())} };
+                if (!exponent || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprPow{std::make_shared<NodeExpr>(base.value()), std::make_shared<NodeExpr>(exponent.value()), tier.value()}, base->is_array || exponent->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::SQRT && peak(1).value().type == TokenType::OPENPAREN){
+            else if (peakIs(TokenType::SQRT) && peakIs(TokenType::OPENPAREN, 1)){
                 consume();
                 consume();
                 auto base = parseExpression();
-                if (!base) return {};
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
-                consume();
-                node_expr = NodeExpr{ NodeExprSqrt{std::make_shared<NodeExpr>(base.value())} };
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprSqrt{std::make_shared<NodeExpr>(base.value())}, base->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::SIN && peak(1).value().type == TokenType::OPENPAREN){
-                consume();
+            else if (peakIs(TokenType::SIN) && peakIs(TokenType::OPENPAREN, 1)){
+                Token name = consume();
                 consume();
+                auto tier = tierOf(name);
+                if (!tier) return {};
                 auto base = parseExpression();
-                if (!base) return {};
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
-                consume();
-                node_expr = NodeExpr{ NodeExprSin{std::make_shared<NodeExpr>(base.value())} };
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprSin{std::make_shared<NodeExpr>(base.value()), tier.value()}, base->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::COS && peak(1).value().type == TokenType::OPENPAREN){
-                consume();
+            else if (peakIs(TokenType::COS) && peakIs(TokenType::OPENPAREN, 1)){
+                Token name = consume();
                 consume();
+                auto tier = tierOf(name);
+                if (!tier) return {};
                 auto base = parseExpression();
-                if (!base) return {};
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
-                consume();
-                node_expr = NodeExpr{ NodeExprCos{std::make_shared<NodeExpr>(base.value())} };
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprCos{std::make_shared<NodeExpr>(base.value()), tier.value()}, base->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::TAN && peak(1).value().type == TokenType::OPENPAREN){
-                consume();
+            else if (peakIs(TokenType::TAN) && peakIs(TokenType::OPENPAREN, 1)){
+                Token name = consume();
                 consume();
+                auto tier = tierOf(name);
+                if (!tier) return {};
                 auto base = parseExpression();
-                if (!base) return {};
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
-                consume();
-                node_expr = NodeExpr{ NodeExprTan{std::make_shared<NodeExpr>(base.value())} };
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprTan{std::make_shared<NodeExpr>(base.value()), tier.value()}, base->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::LOG && peak(1).value().type == TokenType::OPENPAREN) {
-                consume();
+            else if (peakIs(TokenType::LOG) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
                 consume();
+                auto tier = tierOf(name);
+                if (!tier) return {};
                 auto base = parseExpression();
-                if (!base) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::COMMA)) {
-                    return {};
-                }
-                consume();
-
+                if (!base || !expect(TokenType::COMMA, "','")) return {};
                 auto exponent = parseExpression();
-                if (!exponent) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
+                if (!exponent || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprLog{std::make_shared<NodeExpr>(base.value()), std::make_shared<NodeExpr>(exponent.value()), tier.value()}, base->is_array || exponent->is_array };
+            }
+            else if (peakIs(TokenType::LN) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
                 consume();
-                node_expr = NodeExpr{ NodeExprLog{std::make_shared<NodeExpr>(base.value()), std::make_shared<NodeExpr>(exponent.value())} };
+                auto tier = tierOf(name);
+                if (!tier) return {};
+                auto base = parseExpression();
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprLn{std::make_shared<NodeExpr>(base.value()), tier.value()}, base->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::LN && peak(1).value().type == TokenType::OPENPAREN) {
+            else if (peakIs(TokenType::ABS) && peakIs(TokenType::OPENPAREN, 1)){
                 consume();
                 consume();
                 auto base = parseExpression();
-                if (!base) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
-                }
-                consume();
-                node_expr = NodeExpr{ NodeExprLn{std::make_shared<NodeExpr>(base.value())} };
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                node_expr = NodeExpr{ NodeExprAbs{std::make_shared<NodeExpr>(base.value())}, base->is_array };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::ABS && peak(1).value().type == TokenType::OPENPAREN){
-                consume();
+            else if (peakIs(TokenType::RAND) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
                 consume();
                 auto base = parseExpression();
-                if (!base) return {};
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
+                if (!base || !expect(TokenType::COMMA, "','")) return {};
+                auto exponent = parseExpression();
+                if (!exponent || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                if (base->is_array || exponent->is_array) {
+                    return typeError(name, "rand expects scalar bounds");
                 }
-                consume();
-                node_expr = NodeExpr{ NodeExprAbs{std::make_shared<NodeExpr>(base.value())} };
+                node_expr = NodeExpr{ NodeExprRand{std::make_shared<NodeExpr>(base.value()), std::make_shared<NodeExpr>(exponent.value())} };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::RAND && peak(1).value().type == TokenType::OPENPAREN) {
-                consume();
+            else if (peakIs(TokenType::LINSPACE) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
+                consume();
+                auto start = parseExpression();
+                if (!start || !expect(TokenType::COMMA, "','")) return {};
+                auto stop = parseExpression();
+                if (!stop || !expect(TokenType::COMMA, "','")) return {};
+                auto count = parseExpression();
+                if (!count || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                if (start->is_array || stop->is_array || count->is_array) {
+                    return typeError(name, "linspace expects scalar arguments");
+                }
+                m_uses_arrays = true;
+                node_expr = NodeExpr{ NodeExprLinspace{std::make_shared<NodeExpr>(start.value()), std::make_shared<NodeExpr>(stop.value()), std::make_shared<NodeExpr>(count.value())}, true };
+            }
+            else if (peakIs(TokenType::RANGE) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
+                consume();
+                auto start = parseExpression();
+                if (!start || !expect(TokenType::COMMA, "','")) return {};
+                auto stop = parseExpression();
+                if (!stop || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                if (start->is_array || stop->is_array) {
+                    return typeError(name, "range expects scalar arguments");
+                }
+                m_uses_arrays = true;
+                node_expr = NodeExpr{ NodeExprRange{std::make_shared<NodeExpr>(start.value()), std::make_shared<NodeExpr>(stop.value())}, true };
+            }
+            else if ((peakIs(TokenType::SUM) || peakIs(TokenType::MAX) || peakIs(TokenType::MIN)) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
                 consume();
                 auto base = parseExpression();
-                if (!base) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::COMMA)) {
-                    return {};
+                if (!base || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                if (!base->is_array) {
+                    return typeError(name, token_text(name) + " expects an array");
                 }
-                consume();
-
-                auto exponent = parseExpression();
-                if (!exponent) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
+                auto operand = std::make_shared<NodeExpr>(base.value());
+                if (name.type == TokenType::SUM) node_expr = NodeExpr{ NodeExprSum{operand} };
+                else if (name.type == TokenType::MAX) node_expr = NodeExpr{ NodeExprMax{operand} };
+                else node_expr = NodeExpr{ NodeExprMin{operand} };
+            }
+            else if (peakIs(TokenType::DOT) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
+                consume();
+                auto left = parseExpression();
+                if (!left || !expect(TokenType::COMMA, "','")) return {};
+                auto right = parseExpression();
+                if (!right || !expect(TokenType::CLOSEPAREN, "')'")) return {};
+                if (!left->is_array || !right->is_array) {
+                    return typeError(name, "dot expects two arrays");
                 }
-                consume();
-                node_expr = NodeExpr{ NodeExprRand{std::make_shared<NodeExpr>(base.value()), std::make_shared<NodeExpr>(exponent.value())} };
+                node_expr = NodeExpr{ NodeExprDot{std::make_shared<NodeExpr>(left.value()), std::make_shared<NodeExpr>(right.value())} };
             }
-            else {
+            else if (!peakIs(TokenType::MINUS_OP)) {
                 node_expr = parsePrimaryExpression();
-                //if (!node_expr) return {};
+                if (!node_expr) return {};
             }
 
             while (true) {
-                if (peak().has_value() && peak().value().type == TokenType::PLUS_OP) {
+                if (peakIs(TokenType::PLUS_OP)) {
+                    if (!node_expr) return missingOperand();
                     Token op = consume(); 
                     auto right = parsePrimaryExpression();
                     if (!right) return {}; 
 
-                    node_expr = NodeExpr{ NodeBinaryExprPlus{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())} };
+                    node_expr = NodeExpr{ NodeBinaryExprPlus{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())}, node_expr->is_array || right->is_array };
                 } 
-                else if (peak().has_value() && peak().value().type == TokenType::MINUS_OP){
+                else if (peakIs(TokenType::MINUS_OP)){
                     Token op = consume();
                     auto right = parsePrimaryExpression();
                     if (!right) return {}; 
                     if (!node_expr.has_value()) {
-                        node_expr = NodeExpr{ NodeBinaryExprMinus{op, {}, std::make_shared<NodeExpr>(right.value())} };
+                        node_expr = NodeExpr{ NodeBinaryExprMinus{op, {}, std::make_shared<NodeExpr>(right.value())}, right->is_array };
                     }
                     else {
-                        node_expr = NodeExpr{ NodeBinaryExprMinus{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())} };
+                        node_expr = NodeExpr{ NodeBinaryExprMinus{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())}, node_expr->is_array || right->is_array };
                     }                
                 }
-                else if (peak().has_value() && peak().value().type == TokenType::TIMES_OP){
+                else if (peakIs(TokenType::TIMES_OP)){
+                    if (!node_expr) return missingOperand();
                     Token op = consume();
                     auto right = parsePrimaryExpression();
                     if (!right) return {}; 
 
-                    node_expr = NodeExpr{ NodeBinaryExprTimes{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())} };
+                    node_expr = NodeExpr{ NodeBinaryExprTimes{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())}, node_expr->is_array || right->is_array };
                 }
-                else if (peak().has_value() && peak().value().type == TokenType::DIVIDE_OP){
+                else if (peakIs(TokenType::DIVIDE_OP)){
+                    if (!node_expr) return missingOperand();
                     Token op = consume();
                     auto right = parsePrimaryExpression();
                     if (!right) return {}; 
 
-                    node_expr = NodeExpr{ NodeBinaryExprDivision{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())} };
+                    node_expr = NodeExpr{ NodeBinaryExprDivision{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())}, node_expr->is_array || right->is_array };
 
                 }
-                else if (peak().has_value() && peak().value().type == TokenType::MOD){
+                else if (peakIs(TokenType::MOD)){
+                    if (!node_expr) return missingOperand();
                     Token op = consume();
                     auto right = parsePrimaryExpression();
                     if (!right) return {}; 
 
-                    node_expr = NodeExpr{ NodeBinaryExprMod{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())} };
+                    node_expr = NodeExpr{ NodeBinaryExprMod{op, std::make_shared<NodeExpr>(node_expr.value()), std::make_shared<NodeExpr>(right.value())}, node_expr->is_array || right->is_array };
 
                 }
                 else {
@@ -355,19 +524,30 @@ class Parser {
         }   
 
         std::optional<NodeExpr> parseGroupedExpression() {
-            if (peak().has_value() && peak().value().type == TokenType::OPENPAREN) {
-                consume();  
-                auto innerExpr = parseExpression();  
-                if (!innerExpr) return {};
+            consume();  
+            auto innerExpr = parseExpression();  
+            if (!innerExpr || !expect(TokenType::CLOSEPAREN, "')'")) return {};
 
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
+            return NodeExpr{ NodeGroupedExpr{std::make_shared<NodeExpr>(innerExpr.value())}, innerExpr->is_array };
+        }
+
+        std::optional<NodeExpr> parseArrayLiteral() {
+            Token open = consume();
+            NodeExprArray array;
+            while (!peakIs(TokenType::CLOSEBRACKET)) {
+                if (!array.elements.empty() && !expect(TokenType::COMMA, "',' or ']'")) {
                     return {};
                 }
-                consume(); 
-
-                return NodeExpr{ NodeGroupedExpr{std::make_shared<NodeExpr>(innerExpr.value())} };
+                auto element = parseExpression();
+                if (!element) return {};
+                if (element->is_array) {
+                    return typeError(open, "array elements must be scalars");
+                }
+                array.elements.push_back(std::make_shared<NodeExpr>(element.value()));
             }
-            return {};
+            consume();
+            m_uses_arrays = true;
+            return NodeExpr{ array, true };
         }
 
         std::optional<NodeExpr> parsePrimaryExpression() {
@@ -377,78 +557,88 @@ class Parser {
                 } else if (peak().value().type == TokenType::OPENPAREN) {
                     return parseGroupedExpression();
                 }
+                else if (peak().value().type == TokenType::OPENBRACKET) {
+                    return parseArrayLiteral();
+                }
                 else if (peak().value().type == TokenType::IDENTIFIER){
-                    return NodeExpr{ NodeExprIdentifier{consume()} };
+                    Token identifier = consume();
+                    if (!m_declared.count(identifier.value.value()) && !m_failed.count(identifier.value.value())) {
+                        return typeError(identifier, identifier.value.value() + " is not declared");
+                    }
+                    bool is_array = m_array_vars.count(identifier.value.value()) > 0;
+                    return NodeExpr{ NodeExprIdentifier{identifier}, is_array };
                 }
             }
+            error("expected an expression");
             return {};
         }   
         
 
         std::optional<NodeStmt> parseStatement() {
-            if (peak().has_value() && peak().value().type == TokenType::END) {
+            if (peakIs(TokenType::END)) {
                 consume();
-                NodeStmtExit node_stmt_exit;
-                if (auto expr = parseExpression()) {
-                    node_stmt_exit.expr = expr.value();
-                }
-
-                return NodeStmt{ NodeStmtExit{node_stmt_exit.expr} };
+                auto expr = parseExpression();
+                if (!expr) return {};
+                return NodeStmt{ NodeStmtExit{expr.value()} };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::INT){
+            else if (peakIs(TokenType::INT)){
                 consume();
-                if (peak().has_value() && peak().value().type == TokenType::IDENTIFIER){
-                    auto stmt_var = NodeStmtVarINT{consume()};
-                    if (peak().has_value() && peak().value().type == TokenType::EQUALS){
-                        consume();
-                        if (auto expr = parseExpression()){
-                            stmt_var.expr = expr.value();
-                            return NodeStmt{ NodeStmtVarINT{stmt_var.identifier, stmt_var.expr} };
-                        }
-                        else{
-                            return {};
-                        }
-                    }
+                if (peakIs(TokenType::OPENBRACKET)) {
+                    error("only float[] arrays are supported");
+                    return {};
                 }
-            }
-            else if (peak().has_value() && peak().value().type == TokenType::FLOAT){
-                consume();
-                if (peak().has_value() && peak().value().type == TokenType::IDENTIFIER){
-                    auto stmt_var = NodeStmtVarFLOAT{consume()};
-                    if (peak().has_value() && peak().value().type == TokenType::EQUALS){
-                        consume();
-                        if (auto expr = parseExpression()){
-                            stmt_var.expr = expr.value();
-                            return NodeStmt{ NodeStmtVarFLOAT{stmt_var.identifier, stmt_var.expr} };
-                        }
-                        else{
-                            return {};
-                        }
-                    }
+                auto identifier = declaration();
+                if (!identifier) return {};
+                auto expr = parseExpression();
+                define(identifier.value(), false, expr && !expr->is_array);
+                if (!expr) return {};
+                if (expr->is_array) {
+                    return arrayToScalar(identifier.value());
                 }
+                return NodeStmt{ NodeStmtVarINT{identifier.value(), expr.value()} };
             }
-            else if (peak().has_value() && peak().value().type == TokenType::POW && peak(1).value().type == TokenType::OPENPAREN) {
+            else if (peakIs(TokenType::FLOAT) && peakIs(TokenType::OPENBRACKET, 1)){
                 consume();
                 consume();
-                auto base = parseExpression();
-                if (!base) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::COMMA)) {
+                if (!expect(TokenType::CLOSEBRACKET, "']'")) return {};
+                auto identifier = declaration();
+                if (!identifier) return {};
+                auto expr = parseExpression();
+                define(identifier.value(), true, expr && expr->is_array);
+                if (!expr) return {};
+                if (!expr->is_array) {
+                    error(identifier.value(), identifier->value.value() + " is declared float[] but assigned a scalar");
                     return {};
                 }
-                consume();
-
-                auto exponent = parseExpression();
-                if (!exponent) return {};
-
-                if (!(peak().has_value() && peak().value().type == TokenType::CLOSEPAREN)) {
-                    return {};
+                m_uses_arrays = true;
+                return NodeStmt{ NodeStmtVarARRAY{identifier.value(), expr.value()} };
+            }
+            else if (peakIs(TokenType::FLOAT)){
+                consume();
+                auto identifier = declaration();
+                if (!identifier) return {};
+                auto expr = parseExpression();
+                define(identifier.value(), false, expr && !expr->is_array);
+                if (!expr) return {};
+                if (expr->is_array) {
+                    return arrayToScalar(identifier.value());
                 }
+                return NodeStmt{ NodeStmtVarFLOAT{identifier.value(), expr.value()} };
+            }
+            else if (peakIs(TokenType::POW) && peakIs(TokenType::OPENPAREN, 1)) {
+                Token name = consume();
                 consume();
+                auto tier = tierOf(name);
+                if (!tier) return {};
+                auto base = parseExpression();
+                if (!base || !expect(TokenType::COMMA, "','")) return {};
+                auto exponent = parseExpression();
+                if (!exponent || !expect(TokenType::CLOSEPAREN, "')'")) return {};
 
-                return NodeStmt{ NodeStmtPow{base.value(), exponent.value()} };
+                return NodeStmt{ NodeStmtPow{base.value(), exponent.value(), tier.value()} };
             }
             else{
+                error("expected a statement (int, float, fin, pow or math)");
                 return {};
             }
         }
@@ -457,11 +647,133 @@ class Parser {
     private:
         std::vector<Token> tokens;
         int index = 0;
-        std::optional<Token> peak(int offset = 0) {
-            if (index + offset >= tokens.size()) {
+        int m_depth = 0;
+        MathTier m_math_tier = MathTier::Default;
+        bool m_uses_math_tiers = false;
+        bool m_uses_arrays = false;
+        std::unordered_set<std::string> m_declared;
+        std::unordered_set<std::string> m_failed;
+        std::unordered_set<std::string> m_array_vars;
+        std::vector<Diagnostic> m_diagnostics;
+
+        // Reports at the next token, or just past the last one at end of input.
+        void error(const std::string& message) {
+            if (peak().has_value()) {
+                error(peak().value(), message + ", found '" + token_text(peak().value()) + "'");
+            }
+            else if (!tokens.empty()) {
+                error(tokens.back(), message + " at end of file");
+            }
+            else {
+                m_diagnostics.push_back({1, 1, message + " at end of file"});
+            }
+        }
+
+        void error(const Token& at, const std::string& message) {
+            m_diagnostics.push_back({at.line, at.column, message});
+        }
+
+        std::optional<NodeExpr> typeError(const Token& at, const std::string& message) {
+            error(at, message);
+            return {};
+        }
+
+        std::optional<NodeExpr> tooDeep() {
+            error("expression nested more than " + std::to_string(max_expression_depth) + " levels deep");
+            return {};
+        }
+
+        std::optional<NodeExpr> missingOperand() {
+            error("expected an expression before the operator");
+            return {};
+        }
+
+        std::optional<NodeStmt> arrayToScalar(const Token& identifier) {
+            error(identifier, identifier.value.value() + " is assigned an array; declare it float[]");
+            return {};
+        }
+
+        // Reads `name =` of a declaration. The name is only declared once its
+        // initializer has parsed, see define.
+        std::optional<Token> declaration() {
+            if (!peakIs(TokenType::IDENTIFIER)) {
+                error("expected a variable name");
+                return {};
+            }
+            Token identifier = consume();
+            if (m_declared.count(identifier.value.value())) {
+                error(identifier, identifier.value.value() + " is already declared");
+                return {};
+            }
+            if (!expect(TokenType::EQUALS, "'='")) {
+                m_failed.insert(identifier.value.value());
+                return {};
+            }
+            return identifier;
+        }
+
+        // A declaration that failed is remembered apart, so later uses of the
+        // name are not reported as undeclared on top of the original error.
+        void define(const Token& identifier, bool is_array, bool ok) {
+            (ok ? m_declared : m_failed).insert(identifier.value.value());
+            if (is_array) {
+                m_array_vars.insert(identifier.value.value());
+            }
+        }
+
+        // Skips the rest of a bad statement: at least one token, then up to the
+        // next token that can only start a statement.
+        void synchronize(int start) {
+            if (index == start && peak().has_value()) {
+                consume();
+            }
+            while (peak().has_value()) {
+                TokenType type = peak().value().type;
+                if (type == TokenType::INT || type == TokenType::FLOAT || type == TokenType::END || type == TokenType::MATH) {
+                    break;
+                }
+                consume();
+            }
+        }
+
+        // Tier for a builtin: its own `.tier` suffix, else the current `math` directive.
+        std::optional<MathTier> tierOf(const Token& name) {
+            MathTier tier = m_math_tier;
+            if (name.value.has_value()) {
+                auto suffix = parse_math_tier(name.value.value());
+                if (!suffix) {
+                    error(name, "unknown math tier '" + name.value.value() + "', expected exact, precise or fast");
+                    return {};
+                }
+                tier = suffix.value();
+            }
+            if (tier == MathTier::Precise || tier == MathTier::Fast) {
+                m_uses_math_tiers = true;
+            }
+            return tier;
+        }
+
+        bool peakIs(TokenType type, size_t offset = 0) {
+            size_t at = static_cast<size_t>(index) + offset;
+            return at < tokens.size() && tokens[at].type == type;
+        }
+
+        // Consumes the next token if it has the expected type, else reports it.
+        bool expect(TokenType type, const char* what) {
+            if (peakIs(type)) {
+                consume();
+                return true;
+            }
+            error(std::string("expected ") + what);
+            return false;
+        }
+
+        std::optional<Token> peak(size_t offset = 0) {
+            size_t at = static_cast<size_t>(index) + offset;
+            if (at >= tokens.size()) {
                 return {};
             }
-            return tokens[index + offset];
+            return tokens[at];
         }
 
         Token consume() {
@@ -0,0 +1,432 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Parser.hpp"
+
+// Precompiled programs are a flat image of a parsed Node, laid out so that a
+// mapped file can be used in place:
+//
+//   PrecompiledHeader
+//   PrecompiledStmt[stmt_count]
+//   PrecompiledNode[node_count]     children always precede their parent
+//   uint32_t[operand_count]         node indices of variadic operand lists
+//   uint32_t[string_count + 1]      offsets into the string bytes
+//   char[string_bytes]
+//
+// All integers are native-endian. A byte-swapped image fails the version
+// check, since the magic reads the same either way.
+//
+// An image is untrusted input: the generator pastes its names and literals
+// into C++ source, so validation checks their text as well as the layout.
+// It also bounds nesting as the parser does, since the generator and the
+// evaluator recurse into nested nodes.
+
+enum class PrecompiledKind : uint8_t {
+    IntLit, Identifier, Plus, Minus, Times, Division, Mod, Grouped,
+    Pow, Sqrt, Sin, Cos, Tan, Log, Ln, Abs, Rand,
+    Linspace, Range, ArrayLit, Sum, Max, Min, Dot
+};
+
+enum class PrecompiledStmtKind : uint8_t {
+    Exit, VarInt, VarFloat, Pow, VarArray
+};
+
+struct PrecompiledHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t stmt_count;
+    uint32_t node_count;
+    uint32_t string_count;
+    uint32_t string_bytes;
+    uint32_t operand_count;
+    uint32_t flags;
+};
+
+// IntLit and Identifier keep a string index in `a`. Unary nodes use `a`,
+// binary nodes `a` and `b`; a unary minus has `a == none`. Linspace and
+// ArrayLit keep an offset into the operand table in `a` and the operand count
+// in `b`. `tier` holds the MathTier of builtins and is zero elsewhere.
+struct PrecompiledNode
+{
+    PrecompiledKind kind;
+    uint8_t tier;
+    uint16_t flags;
+    uint32_t a;
+    uint32_t b;
+};
+
+struct PrecompiledStmt
+{
+    PrecompiledStmtKind kind;
+    uint8_t tier;
+    uint16_t reserved;
+    uint32_t name;
+    uint32_t a;
+    uint32_t b;
+};
+
+constexpr char precompiled_magic[4] = {'L', 'I', 'C', 1};
+constexpr uint32_t precompiled_version = 3;
+constexpr uint32_t precompiled_flag_math_tiers = 1;
+constexpr uint32_t precompiled_flag_arrays = 2;
+constexpr uint16_t precompiled_node_array = 1;
+constexpr uint32_t precompiled_none = UINT32_MAX;
+
+class PrecompiledWriter {
+public:
+    PrecompiledWriter(const Node& node) : node(node) {}
+
+    std::string write() {
+        for (const auto& stmt : node.node) {
+            std::visit(StmtVisitor{this}, stmt.node);
+        }
+
+        PrecompiledHeader header;
+        std::memcpy(header.magic, precompiled_magic, sizeof(header.magic));
+        header.version = precompiled_version;
+        header.stmt_count = m_stmts.size();
+        header.node_count = m_nodes.size();
+        header.string_count = m_string_offsets.size();
+        header.string_bytes = m_strings.size();
+        header.operand_count = m_operands.size();
+        header.flags = (node.uses_math_tiers ? precompiled_flag_math_tiers : 0) | (node.uses_arrays ? precompiled_flag_arrays : 0);
+        m_string_offsets.push_back(m_strings.size());
+
+        std::string out;
+        out.reserve(sizeof(header) + m_stmts.size() * sizeof(PrecompiledStmt) + m_nodes.size() * sizeof(PrecompiledNode)
+                    + (m_operands.size() + m_string_offsets.size()) * sizeof(uint32_t) + m_strings.size());
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.append(reinterpret_cast<const char*>(m_stmts.data()), m_stmts.size() * sizeof(PrecompiledStmt));
+        out.append(reinterpret_cast<const char*>(m_nodes.data()), m_nodes.size() * sizeof(PrecompiledNode));
+        out.append(reinterpret_cast<const char*>(m_operands.data()), m_operands.size() * sizeof(uint32_t));
+        out.append(reinterpret_cast<const char*>(m_string_offsets.data()), m_string_offsets.size() * sizeof(uint32_t));
+        out.append(m_strings);
+        return out;
+    }
+
+private:
+    const Node& node;
+    std::vector<PrecompiledStmt> m_stmts;
+    std::vector<PrecompiledNode> m_nodes;
+    std::vector<uint32_t> m_operands;
+    std::vector<uint32_t> m_string_offsets;
+    std::string m_strings;
+    std::unordered_map<std::string, uint32_t> m_string_index;
+
+    uint32_t intern(const std::string& value) {
+        auto [it, inserted] = m_string_index.try_emplace(value, m_string_offsets.size());
+        if (inserted) {
+            m_string_offsets.push_back(m_strings.size());
+            m_strings.append(value);
+        }
+        return it->second;
+    }
+
+    uint32_t push(PrecompiledKind kind, uint32_t a, uint32_t b = precompiled_none, MathTier tier = MathTier::Default) {
+        m_nodes.push_back({kind, static_cast<uint8_t>(tier), 0, a, b});
+        return m_nodes.size() - 1;
+    }
+
+    // Operands are written first, so their indices are all below the node's own.
+    uint32_t push_list(PrecompiledKind kind, const std::vector<uint32_t>& operands) {
+        uint32_t offset = m_operands.size();
+        m_operands.insert(m_operands.end(), operands.begin(), operands.end());
+        return push(kind, offset, operands.size());
+    }
+
+    struct StmtVisitor {
+        PrecompiledWriter* writer;
+
+        void operator()(const NodeStmtExit& node_stmt_exit) {
+            writer->m_stmts.push_back({PrecompiledStmtKind::Exit, 0, 0, precompiled_none, writer->write_expr(node_stmt_exit.expr), precompiled_none});
+        }
+        void operator()(const NodeStmtVarINT& node_stmt_var) {
+            uint32_t name = writer->intern(node_stmt_var.identifier.value.value());
+            writer->m_stmts.push_back({PrecompiledStmtKind::VarInt, 0, 0, name, writer->write_expr(node_stmt_var.expr), precompiled_none});
+        }
+        void operator()(const NodeStmtVarFLOAT& node_stmt_var) {
+            uint32_t name = writer->intern(node_stmt_var.identifier.value.value());
+            writer->m_stmts.push_back({PrecompiledStmtKind::VarFloat, 0, 0, name, writer->write_expr(node_stmt_var.expr), precompiled_none});
+        }
+        void operator()(const NodeStmtVarARRAY& node_stmt_var) {
+            uint32_t name = writer->intern(node_stmt_var.identifier.value.value());
+            writer->m_stmts.push_back({PrecompiledStmtKind::VarArray, 0, 0, name, writer->write_expr(node_stmt_var.expr), precompiled_none});
+        }
+        void operator()(const NodeStmtPow& node_stmt_pow) {
+            uint32_t base = writer->write_expr(node_stmt_pow.base);
+            uint32_t exponent = writer->write_expr(node_stmt_pow.exponent);
+            writer->m_stmts.push_back({PrecompiledStmtKind::Pow, static_cast<uint8_t>(node_stmt_pow.tier), 0, precompiled_none, base, exponent});
+        }
+    };
+
+    // A chain is written bottom up along its left spine, so chain length
+    // costs no stack; each link's `left` is the index already written below it.
+    uint32_t write_expr(const NodeExpr& node_expr) {
+        struct ExprVisitor {
+            PrecompiledWriter* writer;
+            uint32_t left;
+
+            uint32_t binary(PrecompiledKind kind, const NodeExpr& left, const NodeExpr& right, MathTier tier = MathTier::Default) {
+                uint32_t a = writer->write_expr(left);
+                uint32_t b = writer->write_expr(right);
+                return writer->push(kind, a, b, tier);
+            }
+            uint32_t unary(PrecompiledKind kind, const NodeExpr& base, MathTier tier = MathTier::Default) {
+                return writer->push(kind, writer->write_expr(base), precompiled_none, tier);
+            }
+
+            uint32_t operator()(const NodeIntLit& node) { return writer->push(PrecompiledKind::IntLit, writer->intern(node.token.value.value())); }
+            uint32_t operator()(const NodeExprIdentifier& node) { return writer->push(PrecompiledKind::Identifier, writer->intern(node.token.value.value())); }
+            uint32_t link(PrecompiledKind kind, const NodeExpr& right) {
+                return writer->push(kind, left, writer->write_expr(right));
+            }
+
+            uint32_t operator()(const NodeBinaryExprPlus& node) { return link(PrecompiledKind::Plus, *node.right); }
+            uint32_t operator()(const NodeBinaryExprMinus& node) { return link(PrecompiledKind::Minus, *node.right); }
+            uint32_t operator()(const NodeBinaryExprTimes& node) { return link(PrecompiledKind::Times, *node.right); }
+            uint32_t operator()(const NodeBinaryExprDivision& node) { return link(PrecompiledKind::Division, *node.right); }
+            uint32_t operator()(const NodeBinaryExprMod& node) { return link(PrecompiledKind::Mod, *node.right); }
+            uint32_t operator()(const NodeGroupedExpr& node) { return unary(PrecompiledKind::Grouped, *node.innerExpr); }
+            uint32_t operator()(const NodeExprPow& node) { return binary(PrecompiledKind::Pow, *node.base, *node.exponent, node.tier); }
+            uint32_t operator()(const NodeExprSqrt& node) { return unary(PrecompiledKind::Sqrt, *node.base); }
+            uint32_t operator()(const NodeExprSin& node) { return unary(PrecompiledKind::Sin, *node.base, node.tier); }
+            uint32_t operator()(const NodeExprCos& node) { return unary(PrecompiledKind::Cos, *node.base, node.tier); }
+            uint32_t operator()(const NodeExprTan& node) { return unary(PrecompiledKind::Tan, *node.base, node.tier); }
+            uint32_t operator()(const NodeExprLog& node) { return binary(PrecompiledKind::Log, *node.base, *node.exponent, node.tier); }
+            uint32_t operator()(const NodeExprLn& node) { return unary(PrecompiledKind::Ln, *node.base, node.tier); }
+            uint32_t operator()(const NodeExprAbs& node) { return unary(PrecompiledKind::Abs, *node.base); }
+            uint32_t operator()(const NodeExprRand& node) { return binary(PrecompiledKind::Rand, *node.base, *node.exponent); }
+            uint32_t operator()(const NodeExprLinspace& node) {
+                return writer->push_list(PrecompiledKind::Linspace, {writer->write_expr(*node.start), writer->write_expr(*node.stop), writer->write_expr(*node.count)});
+            }
+            uint32_t operator()(const NodeExprRange& node) { return binary(PrecompiledKind::Range, *node.start, *node.stop); }
+            uint32_t operator()(const NodeExprArray& node) {
+                std::vector<uint32_t> elements;
+                for (const auto& element : node.elements) {
+                    elements.push_back(writer->write_expr(*element));
+                }
+                return writer->push_list(PrecompiledKind::ArrayLit, elements);
+            }
+            uint32_t operator()(const NodeExprSum& node) { return unary(PrecompiledKind::Sum, *node.base); }
+            uint32_t operator()(const NodeExprMax& node) { return unary(PrecompiledKind::Max, *node.base); }
+            uint32_t operator()(const NodeExprMin& node) { return unary(PrecompiledKind::Min, *node.base); }
+            uint32_t operator()(const NodeExprDot& node) { return binary(PrecompiledKind::Dot, *node.left, *node.right); }
+        };
+        std::vector<const NodeExpr*> spine{&node_expr};
+        while (const NodeExpr* left = chain_left(*spine.back())) {
+            spine.push_back(left);
+        }
+        uint32_t index = precompiled_none;
+        for (size_t i = spine.size(); i-- > 0;) {
+            index = std::visit(ExprVisitor{this, index}, spine[i]->node);
+            if (spine[i]->is_array) {
+                m_nodes[index].flags |= precompiled_node_array;
+            }
+        }
+        return index;
+    }
+};
+
+// Read-only view over a precompiled image. Nothing is copied; accessors point
+// straight into the bytes, which must outlive the view.
+class PrecompiledAst {
+public:
+    PrecompiledAst(const char* data, size_t size) : data(data), size(size) {
+        m_valid = validate();
+    }
+
+    static bool is_precompiled(const char* data, size_t size) {
+        return size >= sizeof(precompiled_magic) && std::memcmp(data, precompiled_magic, sizeof(precompiled_magic)) == 0;
+    }
+
+    bool valid() const { return m_valid; }
+
+    uint32_t stmt_count() const { return m_header.stmt_count; }
+    bool uses_math_tiers() const { return m_header.flags & precompiled_flag_math_tiers; }
+    bool uses_arrays() const { return m_header.flags & precompiled_flag_arrays; }
+    uint32_t node_count() const { return m_header.node_count; }
+    uint32_t string_count() const { return m_header.string_count; }
+
+    const PrecompiledStmt& stmt(uint32_t index) const { return m_stmts[index]; }
+    const PrecompiledNode& node(uint32_t index) const { return m_nodes[index]; }
+    bool is_array(uint32_t index) const { return m_nodes[index].flags & precompiled_node_array; }
+    uint32_t operand(uint32_t index) const { return m_operands[index]; }
+
+    std::string_view string(uint32_t index) const {
+        return std::string_view(m_strings + m_string_offsets[index], m_string_offsets[index + 1] - m_string_offsets[index]);
+    }
+
+private:
+    const char* data;
+    size_t size;
+    bool m_valid = false;
+    PrecompiledHeader m_header{};
+    const PrecompiledStmt* m_stmts = nullptr;
+    const PrecompiledNode* m_nodes = nullptr;
+    const uint32_t* m_operands = nullptr;
+    const uint32_t* m_string_offsets = nullptr;
+    const char* m_strings = nullptr;
+
+    static bool is_unary(PrecompiledKind kind) {
+        switch (kind) {
+            case PrecompiledKind::Grouped: case PrecompiledKind::Sqrt: case PrecompiledKind::Sin:
+            case PrecompiledKind::Cos: case PrecompiledKind::Tan: case PrecompiledKind::Ln:
+            case PrecompiledKind::Abs: case PrecompiledKind::Sum: case PrecompiledKind::Max:
+            case PrecompiledKind::Min:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool is_chain(PrecompiledKind kind) {
+        return kind >= PrecompiledKind::Plus && kind <= PrecompiledKind::Mod;
+    }
+
+    // [A-Za-z_][A-Za-z0-9_]*
+    static bool valid_name(std::string_view text) {
+        if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_')) return false;
+        return std::all_of(text.begin(), text.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+    }
+
+    // Digits with at most one '.', starting with a digit as the tokenizer's do.
+    static bool valid_literal(std::string_view text) {
+        if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) return false;
+        if (std::count(text.begin(), text.end(), '.') > 1) return false;
+        return std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) || c == '.'; });
+    }
+
+    bool validate() {
+        if (size < sizeof(PrecompiledHeader) || reinterpret_cast<uintptr_t>(data) % alignof(PrecompiledNode) != 0) return false;
+        std::memcpy(&m_header, data, sizeof(m_header));
+        if (!is_precompiled(data, size) || m_header.version != precompiled_version) return false;
+
+        uint64_t expected = sizeof(PrecompiledHeader)
+                          + uint64_t(m_header.stmt_count) * sizeof(PrecompiledStmt)
+                          + uint64_t(m_header.node_count) * sizeof(PrecompiledNode)
+                          + uint64_t(m_header.operand_count) * sizeof(uint32_t)
+                          + (uint64_t(m_header.string_count) + 1) * sizeof(uint32_t)
+                          + m_header.string_bytes;
+        if (expected != size) return false;
+
+        const char* cursor = data + sizeof(PrecompiledHeader);
+        m_stmts = reinterpret_cast<const PrecompiledStmt*>(cursor);
+        cursor += m_header.stmt_count * sizeof(PrecompiledStmt);
+        m_nodes = reinterpret_cast<const PrecompiledNode*>(cursor);
+        cursor += m_header.node_count * sizeof(PrecompiledNode);
+        m_operands = reinterpret_cast<const uint32_t*>(cursor);
+        cursor += m_header.operand_count * sizeof(uint32_t);
+        m_string_offsets = reinterpret_cast<const uint32_t*>(cursor);
+        cursor += (m_header.string_count + 1) * sizeof(uint32_t);
+        m_strings = cursor;
+
+        for (uint32_t i = 0; i < m_header.string_count; i++) {
+            if (m_string_offsets[i] > m_string_offsets[i + 1]) return false;
+        }
+        if (m_string_offsets[0] != 0 || m_string_offsets[m_header.string_count] != m_header.string_bytes) return false;
+
+        std::vector<bool> is_name(m_header.string_count), is_literal(m_header.string_count);
+        for (uint32_t i = 0; i < m_header.string_count; i++) {
+            is_name[i] = valid_name(string(i));
+            is_literal[i] = valid_literal(string(i));
+        }
+
+        // Children must come before their parent, which also rules out cycles.
+        // Depth counts nested expressions the way the parser does: a chain's
+        // operands share its level, except that a chain nested as a right
+        // operand (which the parser never produces) costs one like a group.
+        std::vector<uint32_t> depth(m_header.node_count);
+        for (uint32_t i = 0; i < m_header.node_count; i++) {
+            const PrecompiledNode& n = m_nodes[i];
+            if (n.tier > static_cast<uint8_t>(MathTier::Fast) || (n.flags & ~precompiled_node_array)) return false;
+            if (n.kind == PrecompiledKind::IntLit || n.kind == PrecompiledKind::Identifier) {
+                if (n.a >= m_header.string_count) return false;
+                if (!(n.kind == PrecompiledKind::IntLit ? is_literal[n.a] : is_name[n.a])) return false;
+                depth[i] = 1;
+            }
+            else if (n.kind > PrecompiledKind::Dot) {
+                return false;
+            }
+            else if (n.kind == PrecompiledKind::Linspace || n.kind == PrecompiledKind::ArrayLit) {
+                if (n.a > m_header.operand_count || n.b > m_header.operand_count - n.a) return false;
+                if (n.kind == PrecompiledKind::Linspace && n.b != 3) return false;
+                for (uint32_t k = n.a; k < n.a + n.b; k++) {
+                    if (m_operands[k] >= i) return false;
+                    depth[i] = std::max(depth[i], depth[m_operands[k]] + 1);
+                }
+            }
+            else if (is_unary(n.kind)) {
+                if (n.a >= i || n.b != precompiled_none) return false;
+                depth[i] = depth[n.a] + 1;
+            }
+            else {
+                bool optional_left = n.kind == PrecompiledKind::Minus && n.a == precompiled_none;
+                if ((!optional_left && n.a >= i) || n.b >= i) return false;
+                uint32_t left = optional_left ? 0 : depth[n.a];
+                if (is_chain(n.kind)) depth[i] = std::max(left, depth[n.b] + is_chain(m_nodes[n.b].kind));
+                else depth[i] = std::max(left, depth[n.b]) + 1;
+            }
+            if (depth[i] > Parser::max_expression_depth) return false;
+        }
+
+        for (uint32_t i = 0; i < m_header.stmt_count; i++) {
+            const PrecompiledStmt& s = m_stmts[i];
+            if (s.kind > PrecompiledStmtKind::VarArray || s.tier > static_cast<uint8_t>(MathTier::Fast) || s.a >= m_header.node_count) return false;
+            if (s.kind != PrecompiledStmtKind::Exit && s.kind != PrecompiledStmtKind::Pow && (s.name >= m_header.string_count || !is_name[s.name])) return false;
+            if (s.kind == PrecompiledStmtKind::Pow && s.b >= m_header.node_count) return false;
+        }
+        return true;
+    }
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            m_size = st.st_size;
+            if (m_size == 0) {
+                m_ok = true;
+            }
+            else {
+                void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    m_data = static_cast<const char*>(mapped);
+                    m_ok = true;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (m_data) munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    bool ok() const { return m_ok; }
+    const char* data() const { return m_data ? m_data : ""; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_ok = false;
+};
@@ -0,0 +1,273 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Precompiled.hpp"
+#include "Evaluator.hpp"
+
+// One swept variable: `count` evenly spaced values from start to stop.
+struct SweepAxis
+{
+    std::string name;
+    double start;
+    double stop;
+    uint64_t count;
+
+    double at(uint64_t i) const {
+        if (count == 1) return start;
+        return i + 1 == count ? stop : start + (stop - start) * static_cast<double>(i) / static_cast<double>(count - 1);
+    }
+};
+
+// Parses `name=start:stop:count`, e.g. x=0:1:1e6.
+inline std::optional<SweepAxis> parse_sweep_axis(const std::string& spec) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos || eq == 0) return {};
+    double values[3];
+    const char* cursor = spec.c_str() + eq + 1;
+    for (int i = 0; i < 3; i++) {
+        char* end = nullptr;
+        values[i] = std::strtod(cursor, &end);
+        if (end == cursor || *end != (i < 2 ? ':' : '\0')) return {};
+        cursor = end + 1;
+    }
+    if (!(values[2] >= 1 && values[2] <= 1e12) || values[2] != static_cast<double>(static_cast<uint64_t>(values[2]))) return {};
+    return SweepAxis{spec.substr(0, eq), values[0], values[1], static_cast<uint64_t>(values[2])};
+}
+
+// Runs a program once per point of the grid spanned by the axes, the first
+// axis outermost, and writes one tab-separated row per point: the swept
+// values, in the shortest form that reads back as the same double (an int
+// variable's truncated, as the program sees it), then
+// every `fin` value in program order. A point that fails ends
+// its row with the error instead of stopping the sweep.
+//
+// The program is only flattened once. Statements that depend on no swept
+// variable, directly or through other variables, are hoisted: they run once
+// up front, and their `fin` values are reused for every row. The rest run
+// per point, with the swept declarations taking the grid values instead of
+// their initializers. rand() counts as varying, since every point would
+// otherwise see the same draw.
+class Sweep {
+public:
+    Sweep(const PrecompiledAst& ast, std::vector<SweepAxis> axes)
+        : m_ast(ast), m_axes(std::move(axes)), m_prefix(ast) {}
+
+    void set_math_tier(MathTier tier) { m_prefix.set_math_tier(tier); }
+    void set_numeric(NumericBackend backend) { m_prefix.set_numeric(backend); }
+    void set_limits(const EvalLimits& limits) { m_prefix.set_limits(limits); }
+
+    // Returns false if the sweep cannot run at all, which error() describes.
+    bool run(std::ostream& out, unsigned jobs) {
+        if (!resolve_axes() || !hoist()) return false;
+
+        uint64_t points = 1;
+        for (const SweepAxis& axis : m_axes) {
+            if (axis.count > UINT64_MAX / points) {
+                m_error = "the sweep grid is too large";
+                return false;
+            }
+            points *= axis.count;
+        }
+
+        // Points are handed out in chunks, a wave of one chunk per job at a
+        // time, and each wave is written in order before the next starts.
+        jobs = std::max(1u, jobs);
+        const uint64_t chunk = 4096;
+        std::vector<std::string> buffers(jobs);
+        std::random_device seeds;
+        for (uint64_t wave = 0; wave < points; wave += chunk * jobs) {
+            std::vector<std::thread> workers;
+            for (unsigned j = 0; j < jobs; j++) {
+                uint64_t first = wave + j * chunk;
+                uint64_t last = std::min(points, first + chunk);
+                if (first >= last) {
+                    buffers[j].clear();
+                    continue;
+                }
+                uint32_t seed = seeds();
+                if (jobs == 1) {
+                    buffers[j] = run_chunk(first, last, seed);
+                }
+                else {
+                    workers.emplace_back([this, &buffers, j, first, last, seed] { buffers[j] = run_chunk(first, last, seed); });
+                }
+            }
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+            for (const std::string& buffer : buffers) {
+                out << buffer;
+            }
+        }
+        return true;
+    }
+
+    const std::string& error() const { return m_error; }
+
+    // How many statements run once rather than per point.
+    uint32_t hoisted_count() const {
+        return static_cast<uint32_t>(std::count(m_varies.begin(), m_varies.end(), false));
+    }
+
+private:
+    const PrecompiledAst& m_ast;
+    std::vector<SweepAxis> m_axes;
+    std::vector<uint32_t> m_axis_names;
+    std::vector<bool> m_axis_int;
+    std::vector<bool> m_varies;
+    std::vector<uint32_t> m_varying_names;
+    std::vector<std::string> m_hoisted_fins;
+    Evaluator m_prefix;
+    std::string m_error;
+
+    // Each axis must name a scalar variable the program declares.
+    bool resolve_axes() {
+        for (const SweepAxis& axis : m_axes) {
+            std::optional<uint32_t> name;
+            bool is_int = false;
+            for (uint32_t i = 0; i < m_ast.stmt_count(); i++) {
+                const PrecompiledStmt& stmt = m_ast.stmt(i);
+                if ((stmt.kind == PrecompiledStmtKind::VarInt || stmt.kind == PrecompiledStmtKind::VarFloat || stmt.kind == PrecompiledStmtKind::VarArray)
+                    && m_ast.string(stmt.name) == axis.name) {
+                    if (stmt.kind == PrecompiledStmtKind::VarArray) {
+                        m_error = axis.name + " is a float[] and cannot be swept";
+                        return false;
+                    }
+                    name = stmt.name;
+                    is_int = stmt.kind == PrecompiledStmtKind::VarInt;
+                }
+            }
+            if (!name) {
+                m_error = "the program declares no variable " + axis.name + " to sweep";
+                return false;
+            }
+            if (std::find(m_axis_names.begin(), m_axis_names.end(), name.value()) != m_axis_names.end()) {
+                m_error = axis.name + " is swept twice";
+                return false;
+            }
+            m_axis_names.push_back(name.value());
+            m_axis_int.push_back(is_int);
+        }
+        return true;
+    }
+
+    // Marks the statements that vary with the swept variables, then runs
+    // the others once. Children always come before their parents in the
+    // image, so one forward pass over the nodes settles each node; passes
+    // repeat until the set of varying variables stops growing.
+    bool hoist() {
+        std::vector<bool> varying_name(m_ast.string_count());
+        for (uint32_t name : m_axis_names) varying_name[name] = true;
+        std::vector<bool> node_varies(m_ast.node_count());
+        m_varies.assign(m_ast.stmt_count(), false);
+
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (uint32_t i = 0; i < m_ast.node_count(); i++) {
+                node_varies[i] = varies(i, varying_name, node_varies);
+            }
+            for (uint32_t i = 0; i < m_ast.stmt_count(); i++) {
+                const PrecompiledStmt& stmt = m_ast.stmt(i);
+                bool declares = stmt.kind != PrecompiledStmtKind::Exit && stmt.kind != PrecompiledStmtKind::Pow;
+                bool varies_now = node_varies[stmt.a] || (stmt.kind == PrecompiledStmtKind::Pow && node_varies[stmt.b]) || (declares && varying_name[stmt.name]);
+                if (declares && varies_now && !varying_name[stmt.name]) {
+                    varying_name[stmt.name] = true;
+                    changed = true;
+                }
+                m_varies[i] = varies_now;
+            }
+        }
+
+        for (uint32_t i = 0; i < m_ast.stmt_count(); i++) {
+            const PrecompiledStmt& stmt = m_ast.stmt(i);
+            if (m_varies[i] && stmt.kind != PrecompiledStmtKind::Exit && stmt.kind != PrecompiledStmtKind::Pow) {
+                m_varying_names.push_back(stmt.name);
+            }
+        }
+
+        m_hoisted_fins.assign(m_ast.stmt_count(), std::string());
+        if (!m_prefix.start()) return hoist_failed();
+        for (uint32_t i = 0; i < m_ast.stmt_count(); i++) {
+            if (m_varies[i]) continue;
+            std::ostringstream value;
+            if (!m_prefix.run_statement(i, value)) return hoist_failed();
+            m_hoisted_fins[i] = value.str();
+        }
+        return true;
+    }
+
+    bool hoist_failed() {
+        m_error = m_prefix.error().message;
+        return false;
+    }
+
+    bool varies(uint32_t index, const std::vector<bool>& varying_name, const std::vector<bool>& node_varies) const {
+        const PrecompiledNode& n = m_ast.node(index);
+        switch (n.kind) {
+            case PrecompiledKind::IntLit: return false;
+            case PrecompiledKind::Identifier: return varying_name[n.a];
+            case PrecompiledKind::Rand: return true;
+            case PrecompiledKind::Linspace:
+            case PrecompiledKind::ArrayLit:
+                for (uint32_t k = n.a; k < n.a + n.b; k++) {
+                    if (node_varies[m_ast.operand(k)]) return true;
+                }
+                return false;
+            default:
+                return (n.a != precompiled_none && node_varies[n.a]) || (n.b != precompiled_none && node_varies[n.b]);
+        }
+    }
+
+    // Runs points [first, last) on a copy of the hoisted state and returns
+    // their rows.
+    std::string run_chunk(uint64_t first, uint64_t last, uint32_t seed) {
+        Evaluator evaluator = m_prefix;
+        evaluator.seed(seed);
+        std::ostringstream rows;
+        std::vector<double> values(m_axes.size());
+        for (uint64_t point = first; point < last; point++) {
+            uint64_t rest = point;
+            for (size_t a = m_axes.size(); a-- > 0;) {
+                values[a] = m_axes[a].at(rest % m_axes[a].count);
+                if (m_axis_int[a]) values[a] = linum::to_int(values[a]);
+                rest /= m_axes[a].count;
+            }
+            for (size_t a = 0; a < m_axes.size(); a++) {
+                evaluator.bind(m_axis_names[a], values[a]);
+                char text[32];
+                char* end = std::to_chars(text, text + sizeof(text), values[a]).ptr;
+                rows << (a ? "\t" : "");
+                rows.write(text, end - text);
+            }
+
+            bool ok = evaluator.start();
+            bool fin = false;
+            for (uint32_t i = 0; ok && i < m_ast.stmt_count(); i++) {
+                fin = m_ast.stmt(i).kind == PrecompiledStmtKind::Exit;
+                if (fin) rows << "\t";
+                if (!m_varies[i]) {
+                    rows << m_hoisted_fins[i];
+                }
+                else {
+                    ok = evaluator.run_statement(i, rows);
+                }
+            }
+            if (!ok) rows << (fin ? "" : "\t") << "error: " << evaluator.error().message;
+            rows << "\n";
+
+            for (uint32_t name : m_varying_names) {
+                evaluator.forget(name);
+            }
+        }
+        return rows.str();
+    }
+};
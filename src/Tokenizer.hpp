@@ -3,6 +3,7 @@
 #include <vector>
 #include <optional>
 #include <iostream> 
+#include "Diagnostic.hpp"
 
 enum class TokenType{
     INT_LIT,
@@ -28,15 +29,66 @@ enum class TokenType{
     LOG,
     LN,
     ABS,
-    RAND
+    RAND,
+    MATH,
+    OPENBRACKET,
+    CLOSEBRACKET,
+    LINSPACE,
+    RANGE,
+    SUM,
+    DOT,
+    MAX,
+    MIN
 };
 
 struct Token
 {
     TokenType type;
     std::optional<std::string> value;
+    size_t line = 0;
+    size_t column = 0;
 };
 
+// Source spelling of a token, for diagnostics.
+inline std::string token_text(const Token& token) {
+    if (token.value.has_value() && (token.type == TokenType::IDENTIFIER || token.type == TokenType::INT_LIT || token.type == TokenType::FLOAT_LIT)) {
+        return token.value.value();
+    }
+    switch (token.type) {
+        case TokenType::PLUS_OP: return "+";
+        case TokenType::MINUS_OP: return "-";
+        case TokenType::TIMES_OP: return "*";
+        case TokenType::DIVIDE_OP: return "/";
+        case TokenType::MOD: return "mod";
+        case TokenType::OPENPAREN: return "(";
+        case TokenType::CLOSEPAREN: return ")";
+        case TokenType::OPENBRACKET: return "[";
+        case TokenType::CLOSEBRACKET: return "]";
+        case TokenType::INT: return "int";
+        case TokenType::FLOAT: return "float";
+        case TokenType::EQUALS: return "=";
+        case TokenType::END: return "fin";
+        case TokenType::COMMA: return ",";
+        case TokenType::POW: return "pow";
+        case TokenType::SQRT: return "sqrt";
+        case TokenType::SIN: return "sin";
+        case TokenType::COS: return "cos";
+        case TokenType::TAN: return "tan";
+        case TokenType::LOG: return "log";
+        case TokenType::LN: return "ln";
+        case TokenType::ABS: return "abs";
+        case TokenType::RAND: return "rand";
+        case TokenType::MATH: return "math";
+        case TokenType::LINSPACE: return "linspace";
+        case TokenType::RANGE: return "range";
+        case TokenType::SUM: return "sum";
+        case TokenType::DOT: return "dot";
+        case TokenType::MAX: return "max";
+        case TokenType::MIN: return "min";
+        default: return "?";
+    }
+}
+
 class Tokenizer{
 public:
     Tokenizer(std::string input) : input(std::move(input)){}
@@ -46,6 +98,9 @@ public:
         std::string buffer = "";
         
         while(peak().has_value()){
+            size_t line = m_line;
+            size_t column = m_column;
+            size_t count = tokens.size();
             if (isalpha(peak().value())){
                 buffer.push_back(consume());
                 while(peak().has_value() && isalnum(peak().value())){
@@ -76,7 +131,7 @@ public:
                     buffer.clear();
                 }
                 else if (buffer == "pow"){
-                    tokens.push_back({TokenType::POW});
+                    tokens.push_back({TokenType::POW, tier_suffix()});
                     buffer.clear();
                 }
                 else if (buffer == "sqrt"){
@@ -84,23 +139,52 @@ public:
                     buffer.clear();
                 }
                 else if (buffer == "cos"){
-                    tokens.push_back({TokenType::COS});
+                    tokens.push_back({TokenType::COS, tier_suffix()});
                     buffer.clear();
                 }
                 else if (buffer == "sin"){
-                    tokens.push_back({TokenType::SIN});
+                    tokens.push_back({TokenType::SIN, tier_suffix()});
                     buffer.clear();
                 }
                 else if (buffer == "tan"){
-                    tokens.push_back({TokenType::TAN});
+                    tokens.push_back({TokenType::TAN, tier_suffix()});
                     buffer.clear();
                 }
                 else if (buffer == "log"){
-                    tokens.push_back({TokenType::LOG});
+                    tokens.push_back({TokenType::LOG, tier_suffix()});
+                    buffer.clear();
+                }
+                // A directive only where it starts a line; elsewhere math is a name.
+                else if (buffer == "math" && (tokens.empty() || tokens.back().line != line)){
+                    tokens.push_back({TokenType::MATH});
                     buffer.clear();
                 }
                 else if (buffer == "ln"){
-                    tokens.push_back({TokenType::LN});
+                    tokens.push_back({TokenType::LN, tier_suffix()});
+                    buffer.clear();
+                }
+                else if (buffer == "linspace" && call_follows()){
+                    tokens.push_back({TokenType::LINSPACE});
+                    buffer.clear();
+                }
+                else if (buffer == "range" && call_follows()){
+                    tokens.push_back({TokenType::RANGE});
+                    buffer.clear();
+                }
+                else if (buffer == "sum" && call_follows()){
+                    tokens.push_back({TokenType::SUM});
+                    buffer.clear();
+                }
+                else if (buffer == "dot" && call_follows()){
+                    tokens.push_back({TokenType::DOT});
+                    buffer.clear();
+                }
+                else if (buffer == "max" && call_follows()){
+                    tokens.push_back({TokenType::MAX});
+                    buffer.clear();
+                }
+                else if (buffer == "min" && call_follows()){
+                    tokens.push_back({TokenType::MIN});
                     buffer.clear();
                 }
                 else {
@@ -116,7 +200,7 @@ public:
                 while(peak().has_value() && (isdigit(peak().value()) || peak().value() == '.')){
                     if (peak().value() == '.') {
                         if (isFloat) {
-                            std::cerr << "Error: Multiple '.' in number." << std::endl;
+                            m_diagnostics.push_back({m_line, m_column, "multiple '.' in number"});
                         }
                         isFloat = true;
                     }
@@ -154,6 +238,14 @@ public:
                 tokens.push_back({TokenType::CLOSEPAREN});
                 consume();
             }
+            else if (peak().value() == '['){
+                tokens.push_back({TokenType::OPENBRACKET});
+                consume();
+            }
+            else if (peak().value() == ']'){
+                tokens.push_back({TokenType::CLOSEBRACKET});
+                consume();
+            }
             else if (peak().value() == '='){
                 tokens.push_back({TokenType::EQUALS});
                 consume();
@@ -165,18 +257,34 @@ public:
             else if (isspace(peak().value())){
                 consume();
             }
+            // Statements need no terminator, but a trailing ';' is accepted.
+            else if (peak().value() == ';'){
+                consume();
+            }
             else {
+                m_diagnostics.push_back({line, column, std::string("unexpected character '") + peak().value() + "'"});
                 consume();
             }
 
+            if (tokens.size() > count) {
+                tokens.back().line = line;
+                tokens.back().column = column;
+            }
         }    
         m_index = 0;
+        m_line = 1;
+        m_column = 1;
         return tokens;
     };
 
+    const std::vector<Diagnostic>& diagnostics() const { return m_diagnostics; }
+
 private:
     size_t m_index = 0;
+    size_t m_line = 1;
+    size_t m_column = 1;
     std::string input;
+    std::vector<Diagnostic> m_diagnostics;
 
     std::optional<char> peak(int ahead = 0){
         if (m_index + ahead >= input.size()){
@@ -186,6 +294,34 @@ private:
     }
 
     char consume(){
+        if (input[m_index] == '\n') {
+            m_line++;
+            m_column = 1;
+        }
+        else {
+            m_column++;
+        }
         return input[m_index++];
     }
+
+    // The array builtins were added after their names could already be
+    // variables, so they are only keywords where they are called.
+    bool call_follows() const {
+        size_t i = m_index;
+        while (i < input.size() && isspace(static_cast<unsigned char>(input[i]))) i++;
+        return i < input.size() && input[i] == '(';
+    }
+
+    // Reads a precision tier written as `sin.fast(...)` right after a builtin.
+    std::optional<std::string> tier_suffix(){
+        if (!(peak().has_value() && peak().value() == '.' && peak(1).has_value() && isalpha(peak(1).value()))){
+            return {};
+        }
+        consume();
+        std::string tier;
+        while(peak().has_value() && isalnum(peak().value())){
+            tier.push_back(consume());
+        }
+        return tier;
+    }
 };
\ No newline at end of file
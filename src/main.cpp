@@ -1,36 +1,301 @@
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <fstream>
-#include <sstream>
+#include <optional>
 #include <string>
 #include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 #include "Tokenizer.hpp"
 #include "Parser.hpp"
 #include "Generator.hpp"
+#include "Precompiled.hpp"
+#include "Evaluator.hpp"
+#include "Sweep.hpp"
+
+// Tokenizes and parses source, printing every diagnostic in source order.
+std::optional<Node> parse_source(const std::string& path, const MappedFile& input) {
+    Tokenizer tokenizer(std::string(input.data(), input.size()));
+    std::vector<Token> tokens = tokenizer.tokenize();
+    Parser parser(tokens);
+    std::optional<Node> nodes = parser.parse();
+
+    std::vector<Diagnostic> diagnostics = tokenizer.diagnostics();
+    diagnostics.insert(diagnostics.end(), parser.diagnostics().begin(), parser.diagnostics().end());
+    std::stable_sort(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b) {
+        return a.line != b.line ? a.line < b.line : a.column < b.column;
+    });
+    for (const Diagnostic& diagnostic : diagnostics) {
+        print_diagnostic(std::cerr, path, diagnostic);
+    }
+    if (!diagnostics.empty()) return {};
+    return nodes;
+}
+
+// Validates each file without generating code, so a whole corpus is checked
+// in one process. Returns the number of files with errors.
+int check_files(const std::vector<std::string>& paths) {
+    int failed = 0;
+    for (const std::string& path : paths) {
+        MappedFile input(path);
+        bool ok;
+        if (!input.ok()) {
+            std::cerr << "Error: Could not read " << path << std::endl;
+            ok = false;
+        }
+        else if (PrecompiledAst::is_precompiled(input.data(), input.size())) {
+            ok = PrecompiledAst(input.data(), input.size()).valid();
+            if (!ok) {
+                std::cerr << path << ": error: not a valid precompiled program (expected format version " << precompiled_version << ")\n";
+            }
+        }
+        else {
+            ok = parse_source(path, input).has_value();
+        }
+        failed += !ok;
+    }
+    std::cerr << paths.size() - failed << " of " << paths.size() << " files ok" << std::endl;
+    return failed;
+}
+
+// Applies one `--limit name=value`, e.g. steps=1000000 or time-ms=50.
+bool set_limit(EvalLimits& limits, const std::string& spec) {
+    size_t eq = spec.find('=');
+    if (eq == std::string::npos || eq + 1 == spec.size()) return false;
+    std::string name = spec.substr(0, eq);
+    char* end = nullptr;
+    unsigned long long value = std::strtoull(spec.c_str() + eq + 1, &end, 10);
+    if (*end != '\0' || spec[eq + 1] == '-') return false;
+    if (name == "steps") limits.max_steps = value;
+    else if (name == "time-ms") limits.max_time_ms = value;
+    else if (name == "depth" && value <= UINT32_MAX) limits.max_depth = static_cast<uint32_t>(value);
+    else if (name == "nodes" && value <= UINT32_MAX) limits.max_nodes = static_cast<uint32_t>(value);
+    else if (name == "memory") limits.max_memory = value;
+    else return false;
+    return true;
+}
+
+// Each sweep job is a thread, so --jobs beyond this is a typo, not a machine.
+constexpr unsigned long max_jobs = 1024;
 
 int main(int argc, char** argv) {
     if (argv[1] == NULL){
-        std::cout << "Incorrect usage. Please use the following format: ./a.out <filename>" << std::endl;
+        std::cout << "Incorrect usage. Please use the following format: ./a.out <filename> [--emit-only | --eval] [--precompile <output>] [--math exact|precise|fast]\n"
+                     "       ./a.out <filename> [--numeric float32|float64|long-double|q16.16|double-double] ...\n"
+                     "       ./a.out <filename> --sweep <name>=<start>:<stop>:<count>... [--jobs <n>]\n"
+                     "       ./a.out <filename> --sandbox [--limit steps|time-ms|depth|nodes|memory=<n>]...\n"
+                     "       ./a.out --check <filename>..." << std::endl;
         exit(EXIT_FAILURE);
     }
+    bool emit_only = false;
+    bool eval = false;
+    bool check = false;
+    bool sandbox = false;
+    std::vector<std::string> limit_specs;
+    std::vector<SweepAxis> sweep;
+    unsigned jobs = std::thread::hardware_concurrency();
+    std::string precompile_path;
+    MathTier math_tier = MathTier::Default;
+    NumericBackend numeric = NumericBackend::Default;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--emit-only") {
+            emit_only = true;
+        }
+        else if (arg == "--eval") {
+            eval = true;
+        }
+        else if (arg == "--check") {
+            check = true;
+        }
+        // Evaluates in process under default budgets, which --limit can change.
+        else if (arg == "--sandbox") {
+            eval = true;
+            sandbox = true;
+        }
+        else if (arg == "--sweep" && i + 1 < argc) {
+            auto axis = parse_sweep_axis(argv[++i]);
+            if (!axis) {
+                std::cerr << "Error: Bad sweep " << argv[i] << ", expected <name>=<start>:<stop>:<count>." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            sweep.push_back(axis.value());
+            eval = true;
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            const char* text = argv[++i];
+            char* end = nullptr;
+            unsigned long value = std::strtoul(text, &end, 10);
+            if (!std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || value < 1 || value > max_jobs) {
+                std::cerr << "Error: Bad job count " << text << ", expected 1 to " << max_jobs << "." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            jobs = static_cast<unsigned>(value);
+        }
+        else if (arg == "--limit" && i + 1 < argc) {
+            EvalLimits checked;
+            if (!set_limit(checked, argv[++i])) {
+                std::cerr << "Error: Bad limit " << argv[i] << ", expected steps, time-ms, depth, nodes or memory=<n>." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            limit_specs.push_back(argv[i]);
+        }
+        else if (arg == "--precompile" && i + 1 < argc) {
+            precompile_path = argv[++i];
+        }
+        else if (arg == "--math" && i + 1 < argc) {
+            auto tier = parse_math_tier(argv[++i]);
+            if (!tier) {
+                std::cerr << "Error: Unknown math tier " << argv[i] << ", expected exact, precise or fast." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            math_tier = tier.value();
+        }
+        else if (arg == "--numeric" && i + 1 < argc) {
+            auto backend = parse_numeric_backend(argv[++i]);
+            if (!backend) {
+                std::cerr << "Error: Unknown numeric backend " << argv[i] << ", expected float32, float64, long-double, q16.16 or double-double." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            numeric = backend.value();
+        }
+        else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        else {
+            inputs.push_back(arg);
+        }
+    }
 
-    std::string output;
-    {
-        std::stringstream buffer;
-        std::ifstream file(argv[1]);
-        buffer << file.rdbuf();
-        output = buffer.str();
+    // Explicit limits go on top of the sandbox defaults wherever they appear
+    // on the command line, so steps=0 lifts the step budget either way.
+    EvalLimits limits = sandbox ? EvalLimits::sandbox() : EvalLimits{};
+    for (const std::string& spec : limit_specs) {
+        set_limit(limits, spec);
     }
 
-    Tokenizer tokenizer(output);
-    std::vector<Token> tokens = tokenizer.tokenize();
-    Parser parser(tokens);
-    std::optional<Node> nodes = parser.parse();
-    Generator generator(nodes.value());
-    std::string generated_code = generator.generate();
-    {
-        std::ofstream file("output.cpp");
-        file << generated_code;
+    if (check) {
+        if (inputs.empty()) {
+            std::cerr << "Error: --check needs at least one file." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return check_files(inputs) == 0 ? 0 : EXIT_FAILURE;
+    }
+    if (inputs.size() != 1) {
+        std::cerr << "Error: Expected exactly one input file." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const char* path = inputs[0].c_str();
+
+    MappedFile input(path);
+    if (!input.ok()) {
+        std::cerr << "Error: Could not read " << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    bool precompiled = PrecompiledAst::is_precompiled(input.data(), input.size());
+    std::optional<Node> nodes;
+    if (!precompiled) {
+        nodes = parse_source(path, input);
+        if (!nodes) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if (!precompile_path.empty()) {
+        std::cerr << "Error: " << path << " is already precompiled." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (!precompile_path.empty()) {
+        std::ofstream file(precompile_path, std::ios::binary);
+        file << PrecompiledWriter(nodes.value()).write();
+        if (!file) {
+            std::cerr << "Error: Failed to write " << precompile_path << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return 0;
+    }
+
+    // The evaluator runs on the flat image, so source input is flattened first.
+    if (eval) {
+        std::string image = precompiled ? std::string() : PrecompiledWriter(nodes.value()).write();
+        PrecompiledAst ast = precompiled ? PrecompiledAst(input.data(), input.size()) : PrecompiledAst(image.data(), image.size());
+        if (!ast.valid()) {
+            std::cerr << "Error: " << path << " is not a valid precompiled program (expected format version " << precompiled_version << ")." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (!sweep.empty()) {
+            Sweep sweeper(ast, sweep);
+            sweeper.set_math_tier(math_tier);
+            sweeper.set_numeric(numeric);
+            sweeper.set_limits(limits);
+            if (!sweeper.run(std::cout, jobs)) {
+                std::cout.flush();
+                std::cerr << "Error: " << sweeper.error() << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            return 0;
+        }
+        Evaluator evaluator(ast);
+        evaluator.set_math_tier(math_tier);
+        evaluator.set_numeric(numeric);
+        evaluator.set_limits(limits);
+        if (!evaluator.run(std::cout)) {
+            std::cout.flush();
+            const EvalError& error = evaluator.error();
+            if (error.kind == EvalErrorKind::Runtime) {
+                std::cerr << "Error: " << error.message << std::endl;
+            }
+            else {
+                std::cerr << "Error: " << eval_error_name(error.kind) << " exceeded: " << error.message << std::endl;
+            }
+            exit(EXIT_FAILURE);
+        }
+        return 0;
+    }
+
+    std::optional<PrecompiledAst> image;
+    if (precompiled) {
+        image.emplace(input.data(), input.size());
+        if (!image->valid()) {
+            std::cerr << "Error: " << path << " is not a valid precompiled program (expected format version " << precompiled_version << ")." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // float[] values and their kernels are double-only.
+    if (numeric != NumericBackend::Default && (image ? image->uses_arrays() : nodes.value().uses_arrays)) {
+        std::cerr << "Error: float[] values need the default numeric backend." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int fd = open("output.cpp", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open output.cpp for writing." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    bool written;
+    if (image) {
+        Generator generator(*image, fd);
+        generator.set_math_tier(math_tier);
+        generator.set_numeric(numeric);
+        written = generator.emit();
+    }
+    else {
+        Generator generator(std::move(nodes.value()), fd);
+        generator.set_math_tier(math_tier);
+        generator.set_numeric(numeric);
+        written = generator.emit();
+    }
+    if (close(fd) != 0 || !written) {
+        std::cerr << "Error: Failed to write output.cpp." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!emit_only) {
+        system("g++ output.cpp -o out");
     }
-    system("g++ output.cpp -o out");
     return 0;
-}
\ No newline at end of file
+}